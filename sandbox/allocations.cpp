@@ -0,0 +1,123 @@
+#include <cstdlib>
+#include <new>
+#include <atomic>
+
+#include <allocations.h>
+
+namespace we
+{
+  static std::atomic<std::uint64_t> s_count{};
+  static std::atomic<bool> s_counting{};
+
+  static void* allocate(std::size_t size)
+  {
+    if (s_counting.load(std::memory_order_relaxed)) s_count.fetch_add(1, std::memory_order_relaxed);
+
+    if (void* pointer{ std::malloc(size ? size : 1) }) return pointer;
+
+    throw std::bad_alloc{};
+  }
+
+  static void* allocate_aligned(std::size_t size, std::align_val_t alignment)
+  {
+    if (s_counting.load(std::memory_order_relaxed)) s_count.fetch_add(1, std::memory_order_relaxed);
+
+    std::size_t align{ static_cast<std::size_t>(alignment) };
+
+#if defined(_MSC_VER)
+    void* pointer{ _aligned_malloc(size ? size : 1, align) };
+#else
+    // aligned_alloc wants a multiple of the alignment
+    void* pointer{ std::aligned_alloc(align, ((size ? size : 1) + align - 1) / align * align) };
+#endif
+
+    if (pointer) return pointer;
+
+    throw std::bad_alloc{};
+  }
+
+  static void release_aligned(void* pointer)
+  {
+#if defined(_MSC_VER)
+    _aligned_free(pointer);
+#else
+    std::free(pointer);
+#endif
+  }
+
+  void allocations::start()
+  {
+    s_count = 0;
+    s_counting = true;
+  }
+
+  void allocations::stop()
+  {
+    s_counting = false;
+  }
+
+  std::uint64_t allocations::get_count()
+  {
+    return s_count.load();
+  }
+}
+
+void* operator new(std::size_t size)
+{
+  return we::allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+  return we::allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+  return we::allocate_aligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+  return we::allocate_aligned(size, alignment);
+}
+
+void operator delete(void* pointer) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+  we::release_aligned(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept
+{
+  we::release_aligned(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept
+{
+  we::release_aligned(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept
+{
+  we::release_aligned(pointer);
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#ifndef WE_ALLOCATIONS_H
+#define WE_ALLOCATIONS_H
+
+#include <cstdint>
+
+namespace we
+{
+  // allocations.cpp replaces the global operator new and delete, aligned overloads included,
+  // so every heap allocation of the program passes through it. Between start and stop each
+  // one is counted, for checks that a path does not allocate. Kept out of main.cpp so the
+  // replacements are never inlined into callers.
+  class allocations
+  {
+  public:
+    allocations() = delete;
+
+  public:
+    static void start();
+    static void stop();
+    static std::uint64_t get_count();
+  };
+}
+
+#endif
\ No newline at end of file
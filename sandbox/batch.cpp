@@ -0,0 +1,583 @@
+#include <chrono>
+
+#include <batch.h>
+
+namespace we
+{
+  batch::batch(std::uint32_t system_width, std::uint32_t system_height, std::uint32_t generator_width, std::uint32_t generator_height, std::uint32_t world_count, std::uint32_t thread_count)
+    : m_system_width{ system_width }
+    , m_system_height{ system_height }
+    , m_generator_width{ generator_width }
+    , m_generator_height{ generator_height }
+    , m_world_count{ world_count }
+    , m_pool{ thread_count }
+  {
+    // Every world starts out on the same empty set
+    m_sets.resize(1);
+    m_world_sets.resize(m_world_count);
+
+    m_generators.resize(m_world_count * m_generator_width * m_generator_height * 4);
+
+    m_band_count = (m_system_height + s_band_rows - 1) / s_band_rows;
+
+    m_front_active.resize(m_world_count * m_band_count);
+    m_back_active.resize(m_world_count * m_band_count);
+    m_next_active.resize(m_world_count * m_band_count);
+    m_needed.resize(m_world_count * m_band_count);
+    m_active_bands.resize(m_world_count);
+
+    m_sums.resize(m_pool.get_thread_count());
+    m_rows.resize(m_pool.get_thread_count());
+
+    rebuild_halo();
+  }
+
+  void batch::set_kernels(std::uint32_t world, const std::unordered_multimap<std::uint32_t, kernel>& kernels)
+  {
+    std::vector<slot> slots{};
+
+    for (const auto& [channel, kernel] : kernels)
+    {
+      // Same target and order as engine::set_kernels
+      std::uint32_t index{ static_cast<std::uint32_t>(kernel.name.back() - '0') };
+
+      slots.emplace_back(slot{ kernel, (index + 3 - kernel.channel % 3) % 3 });
+
+      std::vector<std::float_t>& weights{ slots.back().weights };
+
+      weights.resize(kernel.size * kernel.size);
+
+      for (std::uint32_t i{}; i < kernel.size * kernel.size; i++)
+      {
+        weights[i] = kernel.values[i];
+      }
+    }
+
+    std::sort(slots.begin(), slots.end(), [](const slot& a, const slot& b)
+    {
+      return a.kernel.channel != b.kernel.channel ? a.kernel.channel < b.kernel.channel : a.kernel.name < b.kernel.name;
+    });
+
+    auto it{ std::find_if(m_sets.begin(), m_sets.end(), [&](const std::vector<slot>& set) { return is_same(set, slots); }) };
+
+    if (it == m_sets.end())
+    {
+      m_world_sets[world] = static_cast<std::uint32_t>(m_sets.size());
+
+      m_sets.emplace_back(std::move(slots));
+    }
+    else
+    {
+      m_world_sets[world] = static_cast<std::uint32_t>(it - m_sets.begin());
+    }
+
+    prune_sets();
+    rebuild_halo();
+  }
+
+  void batch::set_storage(engine::storage storage)
+  {
+    if (storage == m_storage) return;
+
+    std::vector<std::vector<std::float_t>> values(m_world_count);
+
+    for (std::uint32_t world{}; world < m_world_count; world++)
+    {
+      get_state(world, values[world]);
+    }
+
+    m_storage = storage;
+
+    std::size_t size{ static_cast<std::size_t>(m_plane_size) * 3 * m_world_count };
+
+    // Only one representation is held, bands of the back buffer are rewritten before they are read
+    for (state* planes : { &m_front, &m_back })
+    {
+      planes->values.assign(engine::is_narrow(storage) ? 0 : size, 0.0f);
+      planes->bits.assign(engine::is_narrow(storage) ? size : 0, 0);
+
+      planes->values.shrink_to_fit();
+      planes->bits.shrink_to_fit();
+    }
+
+    std::fill(m_back_active.begin(), m_back_active.end(), 0);
+
+    for (std::uint32_t world{}; world < m_world_count; world++)
+    {
+      set_state(world, values[world]);
+    }
+  }
+
+  void batch::set_state(std::uint32_t world, const std::vector<std::float_t>& values)
+  {
+    for (std::uint32_t c{}; c < 3; c++)
+    {
+      std::size_t plane{ get_plane(world, c) };
+
+      for (std::uint32_t y{}; y < m_system_height; y++)
+      {
+        for (std::uint32_t x{}; x < m_system_width; x++)
+        {
+          save(m_front, plane + get_cell(x, y), values[(x + y * m_system_width) * 4 + c]);
+        }
+      }
+    }
+
+    wrap_world(world);
+
+    for (std::uint32_t band{}; band < m_band_count; band++)
+    {
+      m_front_active[world * m_band_count + band] = !is_zero(m_front, world, band);
+    }
+  }
+
+  void batch::set_generator(std::uint32_t world, const std::vector<std::float_t>& values)
+  {
+    std::uint32_t size{ m_generator_width * m_generator_height * 4 };
+
+    for (std::uint32_t i{}; i < size; i++)
+    {
+      m_generators[world * size + i] = store(values[i]);
+    }
+  }
+
+  void batch::get_state(std::uint32_t world, std::vector<std::float_t>& values) const
+  {
+    values.resize(m_system_width * m_system_height * 4);
+
+    for (std::uint32_t y{}; y < m_system_height; y++)
+    {
+      for (std::uint32_t x{}; x < m_system_width; x++)
+      {
+        std::uint32_t idx{ (x + y * m_system_width) * 4 };
+
+        values[idx + 0] = load(m_front, get_plane(world, 0) + get_cell(x, y));
+        values[idx + 1] = load(m_front, get_plane(world, 1) + get_cell(x, y));
+        values[idx + 2] = load(m_front, get_plane(world, 2) + get_cell(x, y));
+        values[idx + 3] = 1.0f;
+      }
+    }
+  }
+
+  void batch::step()
+  {
+    auto start{ std::chrono::steady_clock::now() };
+
+    std::uint32_t bands{ m_band_count };
+    std::uint64_t world_bytes{ static_cast<std::uint64_t>(m_plane_size) * 3 * 2 * (engine::is_narrow(m_storage) ? sizeof(std::uint16_t) : sizeof(std::float_t)) };
+
+    bool world_outer{ world_bytes <= s_cache_budget };
+
+    rebuild_needed();
+
+    m_pool.dispatch(m_world_count * bands, 1, [&](std::uint32_t begin, std::uint32_t end)
+    {
+      std::vector<std::float_t>& sums{ m_sums[m_pool.get_worker()] };
+      std::vector<std::float_t>& rows{ m_rows[m_pool.get_worker()] };
+
+      for (std::uint32_t unit{ begin }; unit < end; unit++)
+      {
+        std::uint32_t world{ world_outer ? unit / bands : unit % m_world_count };
+        std::uint32_t band{ world_outer ? unit % bands : unit / m_world_count };
+        std::uint32_t index{ world * bands + band };
+
+        std::uint32_t row_begin{ band * s_band_rows };
+        std::uint32_t row_end{ std::min(row_begin + s_band_rows, m_system_height) };
+
+        if (m_needed[index])
+        {
+          step_rows(world, row_begin, row_end, sums, rows);
+
+          m_next_active[index] = !is_zero(m_back, world, band);
+        }
+        else
+        {
+          // Nothing within reach, the band stays exactly zero
+          if (m_back_active[index]) clear_band(world, band);
+
+          m_next_active[index] = 0;
+        }
+      }
+    });
+
+    std::swap(m_front, m_back);
+
+    std::swap(m_back_active, m_front_active);
+    std::swap(m_front_active, m_next_active);
+
+    m_pool.dispatch(m_world_count, 16, [&](std::uint32_t begin, std::uint32_t end)
+    {
+      for (std::uint32_t world{ begin }; world < end; world++)
+      {
+        inject_generator(world);
+        wrap_world(world);
+      }
+    });
+
+    auto end{ std::chrono::steady_clock::now() };
+
+    m_cells += static_cast<std::uint64_t>(m_system_width) * m_system_height * m_world_count;
+    m_worlds += m_world_count;
+    m_seconds += std::chrono::duration<std::double_t>(end - start).count();
+  }
+
+  void batch::rebuild_needed()
+  {
+    std::vector<std::uint8_t>& skippable{ m_skippable };
+
+    skippable.resize(m_sets.size());
+
+    // Same condition as engine::is_skippable, per kernel set
+    for (std::uint32_t i{}; i < m_sets.size(); i++)
+    {
+      skippable[i] = m_skipping;
+
+      for (const slot& slot : m_sets[i])
+      {
+        const kernel& kernel{ slot.kernel };
+
+        std::float_t g{ system::bump(0.0f, kernel.growth.height, kernel.growth.offset, kernel.growth.smoothness, kernel.growth.sharpness) };
+
+        if (!std::isfinite(g) || g == 0.0f || !std::isfinite(kernel.time)) skippable[i] = 0;
+      }
+    }
+
+    std::fill(m_needed.begin(), m_needed.end(), 0);
+
+    for (std::uint32_t world{}; world < m_world_count; world++)
+    {
+      std::uint8_t* needed{ &m_needed[world * m_band_count] };
+      const std::uint8_t* active{ &m_front_active[world * m_band_count] };
+
+      if (!skippable[m_world_sets[world]])
+      {
+        std::fill_n(needed, m_band_count, 1);
+      }
+      else
+      {
+        // Bands whose rows lie within m_halo of an active one, wrapping like the taps
+        for (std::uint32_t band{}; band < m_band_count; band++)
+        {
+          if (!active[band]) continue;
+
+          std::int64_t first{ static_cast<std::int64_t>(band * s_band_rows) - m_halo };
+          std::int64_t last{ static_cast<std::int64_t>(std::min((band + 1) * s_band_rows, m_system_height)) + m_halo };
+
+          if (last - first >= m_system_height)
+          {
+            std::fill_n(needed, m_band_count, 1);
+
+            break;
+          }
+
+          for (std::int64_t y{ first }; y < last;)
+          {
+            std::uint32_t row{ static_cast<std::uint32_t>(((y % m_system_height) + m_system_height) % m_system_height) };
+
+            needed[row / s_band_rows] = 1;
+
+            y += std::min((row / s_band_rows + 1) * s_band_rows, m_system_height) - row;
+          }
+        }
+      }
+
+      m_active_bands[world] = static_cast<std::uint32_t>(std::count(needed, needed + m_band_count, 1));
+    }
+  }
+
+  bool batch::is_zero(const state& planes, std::uint32_t world, std::uint32_t band) const
+  {
+    std::uint32_t row_end{ std::min((band + 1) * s_band_rows, m_system_height) };
+
+    for (std::uint32_t c{}; c < 3; c++)
+    {
+      for (std::uint32_t y{ band * s_band_rows }; y < row_end; y++)
+      {
+        std::size_t row{ get_plane(world, c) + get_cell(0, y) };
+
+        for (std::uint32_t x{}; x < m_system_width; x++)
+        {
+          if (load(planes, row + x) != 0.0f) return false;
+        }
+      }
+    }
+
+    return true;
+  }
+
+  void batch::clear_band(std::uint32_t world, std::uint32_t band)
+  {
+    std::uint32_t row_end{ std::min((band + 1) * s_band_rows, m_system_height) };
+
+    for (std::uint32_t c{}; c < 3; c++)
+    {
+      for (std::uint32_t y{ band * s_band_rows }; y < row_end; y++)
+      {
+        std::size_t row{ get_plane(world, c) + get_cell(0, y) };
+
+        if (m_back.bits.empty()) std::fill_n(&m_back.values[row], m_system_width, 0.0f);
+        else std::fill_n(&m_back.bits[row], m_system_width, std::uint16_t{});
+      }
+    }
+  }
+
+  bool batch::is_same(const std::vector<slot>& a, const std::vector<slot>& b)
+  {
+    if (a.size() != b.size()) return false;
+
+    for (std::uint32_t i{}; i < a.size(); i++)
+    {
+      const kernel& ka{ a[i].kernel };
+      const kernel& kb{ b[i].kernel };
+
+      if (ka.name != kb.name || ka.channel != kb.channel || ka.size != kb.size || ka.time != kb.time) return false;
+      if (ka.growth.height != kb.growth.height || ka.growth.offset != kb.growth.offset) return false;
+      if (ka.growth.smoothness != kb.growth.smoothness || ka.growth.sharpness != kb.growth.sharpness) return false;
+      if (a[i].weights != b[i].weights) return false;
+    }
+
+    return true;
+  }
+
+  void batch::prune_sets()
+  {
+    std::vector<std::uint32_t> remap(m_sets.size(), 0);
+
+    for (std::uint32_t set : m_world_sets)
+    {
+      remap[set] = 1;
+    }
+
+    std::uint32_t count{};
+    for (std::uint32_t i{}; i < m_sets.size(); i++)
+    {
+      if (!remap[i]) continue;
+
+      if (count != i) m_sets[count] = std::move(m_sets[i]);
+
+      remap[i] = count++;
+    }
+
+    m_sets.resize(count);
+
+    for (std::uint32_t& set : m_world_sets)
+    {
+      set = remap[set];
+    }
+  }
+
+  void batch::rebuild_halo()
+  {
+    // Widest reach of a tap, see engine::convolve_rows for the offsets
+    std::uint32_t halo{};
+    for (const std::vector<slot>& set : m_sets)
+    {
+      for (const slot& slot : set)
+      {
+        halo = std::max(halo, slot.kernel.size / 2);
+      }
+    }
+
+    bool narrow{ engine::is_narrow(m_storage) };
+    bool empty{ m_front.values.empty() && m_front.bits.empty() };
+
+    if (halo == m_halo && !empty) return;
+
+    std::uint32_t padded_width{ m_system_width + halo * 2 };
+    std::uint32_t padded_height{ m_system_height + halo * 2 };
+    std::uint32_t plane_size{ padded_width * padded_height };
+
+    std::size_t size{ static_cast<std::size_t>(plane_size) * 3 * m_world_count };
+
+    state front{};
+
+    front.values.resize(narrow ? 0 : size);
+    front.bits.resize(narrow ? size : 0);
+
+    // Move the interiors over into the new layout
+    if (!empty)
+    {
+      for (std::uint32_t plane{}; plane < m_world_count * 3; plane++)
+      {
+        for (std::uint32_t y{}; y < m_system_height; y++)
+        {
+          std::size_t src{ static_cast<std::size_t>(plane) * m_plane_size + get_cell(0, y) };
+          std::size_t dst{ static_cast<std::size_t>(plane) * plane_size + (halo + (halo + y) * padded_width) };
+
+          if (narrow) std::copy_n(&m_front.bits[src], m_system_width, &front.bits[dst]);
+          else std::copy_n(&m_front.values[src], m_system_width, &front.values[dst]);
+        }
+      }
+    }
+
+    m_halo = halo;
+    m_padded_width = padded_width;
+    m_padded_height = padded_height;
+    m_plane_size = plane_size;
+
+    m_front = std::move(front);
+    m_back.values.assign(m_front.values.size(), 0.0f);
+    m_back.bits.assign(m_front.bits.size(), 0);
+
+    std::fill(m_back_active.begin(), m_back_active.end(), 0);
+
+    m_wrap_x.resize(m_padded_width);
+    m_wrap_y.resize(m_padded_height);
+
+    for (std::uint32_t i{}; i < m_padded_width; i++)
+    {
+      std::int64_t x{ static_cast<std::int64_t>(i) - m_halo };
+      m_wrap_x[i] = static_cast<std::uint32_t>(((x % m_system_width) + m_system_width) % m_system_width);
+    }
+
+    for (std::uint32_t j{}; j < m_padded_height; j++)
+    {
+      std::int64_t y{ static_cast<std::int64_t>(j) - m_halo };
+      m_wrap_y[j] = static_cast<std::uint32_t>(((y % m_system_height) + m_system_height) % m_system_height);
+    }
+
+    for (std::uint32_t world{}; world < m_world_count; world++)
+    {
+      wrap_world(world);
+    }
+  }
+
+  void batch::wrap_world(std::uint32_t world)
+  {
+    if (m_front.bits.empty()) wrap_planes(m_front.values, world);
+    else wrap_planes(m_front.bits, world);
+  }
+
+  template<typename value>
+  void batch::wrap_planes(std::vector<value>& planes, std::uint32_t world)
+  {
+    for (std::uint32_t c{}; c < 3; c++)
+    {
+      value* plane{ &planes[get_plane(world, c)] };
+
+      // Columns first on the interior rows, then whole rows above and below
+      for (std::uint32_t y{}; y < m_system_height; y++)
+      {
+        value* row{ &plane[(m_halo + y) * m_padded_width] };
+
+        for (std::uint32_t i{}; i < m_halo; i++)
+        {
+          row[i] = row[m_halo + m_wrap_x[i]];
+          row[m_halo + m_system_width + i] = row[m_halo + m_wrap_x[m_halo + m_system_width + i]];
+        }
+      }
+
+      for (std::uint32_t j{}; j < m_halo; j++)
+      {
+        std::uint32_t top{ j };
+        std::uint32_t bottom{ m_halo + m_system_height + j };
+
+        std::copy_n(&plane[(m_halo + m_wrap_y[top]) * m_padded_width], m_padded_width, &plane[top * m_padded_width]);
+        std::copy_n(&plane[(m_halo + m_wrap_y[bottom]) * m_padded_width], m_padded_width, &plane[bottom * m_padded_width]);
+      }
+    }
+  }
+
+  void batch::step_rows(std::uint32_t world, std::uint32_t row_begin, std::uint32_t row_end, std::vector<std::float_t>& sums, std::vector<std::float_t>& rows)
+  {
+    const std::vector<slot>& slots{ m_sets[m_world_sets[world]] };
+
+    const std::float_t* front[3]{};
+
+    // Padded row of the first one front holds, 16 bit states widen just the rows the band reaches
+    std::uint32_t first{};
+
+    if (m_front.bits.empty())
+    {
+      for (std::uint32_t c{}; c < 3; c++) front[c] = &m_front.values[get_plane(world, c)];
+    }
+    else
+    {
+      std::uint32_t band_size{ (row_end - row_begin + m_halo * 2) * m_padded_width };
+
+      rows.resize(band_size * 3);
+
+      for (std::uint32_t c{}; c < 3; c++)
+      {
+        const std::uint16_t* plane{ &m_front.bits[get_plane(world, c) + row_begin * m_padded_width] };
+
+        for (std::uint32_t i{}; i < band_size; i++)
+        {
+          rows[c * band_size + i] = engine::widen(plane[i], m_storage);
+        }
+
+        front[c] = &rows[c * band_size];
+      }
+
+      first = row_begin;
+    }
+
+    sums.resize(slots.size() * m_system_width);
+
+    for (std::uint32_t y{ row_begin }; y < row_end; y++)
+    {
+      for (std::uint32_t s{}; s < slots.size(); s++)
+      {
+        const kernel& kernel{ slots[s].kernel };
+
+        std::uint32_t origin{ m_halo - kernel.size / 2 };
+
+        const std::float_t* src{ &front[kernel.channel][origin + (origin + y - first) * m_padded_width] };
+
+        simd::convolve_row(m_isa, src, m_padded_width, &slots[s].weights[0], kernel.size, &sums[s * m_system_width], m_system_width);
+      }
+
+      for (std::uint32_t x{}; x < m_system_width; x++)
+      {
+        std::uint32_t cell{ get_cell(x, y) };
+        std::uint32_t local{ cell - first * m_padded_width };
+        std::array<std::float_t, 3> mix{ front[0][local], front[1][local], front[2][local] };
+
+        for (std::uint32_t s{}; s < slots.size(); s++)
+        {
+          const kernel& kernel{ slots[s].kernel };
+
+          std::float_t sum{ sums[s * m_system_width + x] };
+
+          std::float_t g{ system::bump(sum, kernel.growth.height, kernel.growth.offset, kernel.growth.smoothness, kernel.growth.sharpness) };
+          std::float_t avg{ sum / static_cast<std::float_t>(kernel.size * kernel.size) };
+
+          mix[slots[s].target] += kernel.time * avg / g;
+        }
+
+        save(m_back, get_plane(world, 0) + cell, mix[0]);
+        save(m_back, get_plane(world, 1) + cell, mix[1]);
+        save(m_back, get_plane(world, 2) + cell, mix[2]);
+      }
+    }
+  }
+
+  void batch::inject_generator(std::uint32_t world)
+  {
+    std::uint32_t offset_x{ m_system_width / 2 };
+    std::uint32_t offset_y{ m_system_height / 2 };
+
+    std::uint32_t width{ std::min(m_generator_width, m_system_width - offset_x) };
+    std::uint32_t height{ std::min(m_generator_height, m_system_height - offset_y) };
+
+    const std::float_t* generator{ &m_generators[world * m_generator_width * m_generator_height * 4] };
+
+    for (std::uint32_t j{}; j < height; j++)
+    {
+      m_front_active[world * m_band_count + (offset_y + j) / s_band_rows] = 1;
+    }
+
+    for (std::uint32_t c{}; c < 3; c++)
+    {
+      std::size_t plane{ get_plane(world, c) };
+
+      for (std::uint32_t j{}; j < height; j++)
+      {
+        for (std::uint32_t i{}; i < width; i++)
+        {
+          save(m_front, plane + get_cell(offset_x + i, offset_y + j), generator[(i + j * m_generator_width) * 4 + c]);
+        }
+      }
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,165 @@
+#ifndef WE_BATCH_H
+#define WE_BATCH_H
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <unordered_map>
+
+#include <system.h>
+#include <engine.h>
+#include <thread_pool.h>
+#include <simd.h>
+
+namespace we
+{
+  // Steps many worlds of the same size together for screening runs where nothing is drawn.
+  // Every world is stored planar, one plane per channel surrounded by a toroidal halo of
+  // half the widest kernel, and all planes share one allocation indexed by world * 3 + channel.
+  // The halo is refreshed after each step, so every tap is a plain contiguous load.
+  //
+  // Worlds whose kernels match share one kernel set, which keeps the weights of a batch
+  // that only differs in state hot across all of them.
+  //
+  // Work is split into bands of s_band_rows rows. When one world fits in s_cache_budget the
+  // bands run world by world so its planes stay cached, otherwise the world is the inner
+  // index so the current rows of the shared weights stay cached instead.
+  //
+  // Bands with no nonzero colour within the halo of any of their rows are skipped and only
+  // cleared when the back buffer does not hold zeros there already, under the same growth
+  // condition as engine. get_active_bands reports how many bands a world ran last step.
+  //
+  // Half and bfloat16 storage keeps 16 bits per value like engine, and each band widens the
+  // rows its taps reach into fp32 before convolving them.
+  //
+  // Only the direct convolution is implemented. Colour channels match engine bit for bit,
+  // alpha is not stored and reads back as one.
+  class batch
+  {
+  public:
+    inline static const std::uint32_t s_band_rows{ 16 };
+    inline static const std::uint32_t s_cache_budget{ 1024 * 1024 };
+
+  public:
+    batch(std::uint32_t system_width, std::uint32_t system_height, std::uint32_t generator_width, std::uint32_t generator_height, std::uint32_t world_count, std::uint32_t thread_count);
+
+  public:
+    inline std::uint32_t get_world_count() const { return m_world_count; }
+    inline std::uint32_t get_set_count() const { return static_cast<std::uint32_t>(m_sets.size()); }
+    inline std::uint32_t get_thread_count() const { return m_pool.get_thread_count(); }
+    inline const thread_pool& get_pool() const { return m_pool; }
+    inline std::double_t get_cells_per_second() const { return m_seconds > 0.0 ? static_cast<std::double_t>(m_cells) / m_seconds : 0.0; }
+    inline std::double_t get_worlds_per_second() const { return m_seconds > 0.0 ? static_cast<std::double_t>(m_worlds) / m_seconds : 0.0; }
+
+    inline void set_isa(simd::isa isa) { m_isa = std::min(isa, simd::detect()); }
+    inline simd::isa get_isa() const { return m_isa; }
+
+    void set_storage(engine::storage storage);
+    inline engine::storage get_storage() const { return m_storage; }
+
+    inline void set_skipping(bool skipping) { m_skipping = skipping; }
+    inline bool get_skipping() const { return m_skipping; }
+    inline std::uint32_t get_band_count() const { return m_band_count; }
+    inline std::uint32_t get_active_bands(std::uint32_t world) const { return m_active_bands[world]; }
+
+  public:
+    void set_kernels(std::uint32_t world, const std::unordered_multimap<std::uint32_t, kernel>& kernels);
+    void set_state(std::uint32_t world, const std::vector<std::float_t>& values);
+    void set_generator(std::uint32_t world, const std::vector<std::float_t>& values);
+    void get_state(std::uint32_t world, std::vector<std::float_t>& values) const;
+
+  public:
+    void step();
+
+  private:
+    struct slot
+    {
+      we::kernel kernel{};
+      std::uint32_t target{};
+      std::vector<std::float_t> weights{};
+    };
+
+    // Padded planes of every world in fp32, or in 16 bits for half and bfloat16 with values left empty
+    struct state
+    {
+      std::vector<std::float_t> values{};
+      std::vector<std::uint16_t> bits{};
+    };
+
+  private:
+    static bool is_same(const std::vector<slot>& a, const std::vector<slot>& b);
+
+  private:
+    void prune_sets();
+    void rebuild_halo();
+    void wrap_world(std::uint32_t world);
+    void step_rows(std::uint32_t world, std::uint32_t row_begin, std::uint32_t row_end, std::vector<std::float_t>& sums, std::vector<std::float_t>& rows);
+    void inject_generator(std::uint32_t world);
+    void rebuild_needed();
+    bool is_zero(const state& planes, std::uint32_t world, std::uint32_t band) const;
+
+    template<typename value>
+    void wrap_planes(std::vector<value>& planes, std::uint32_t world);
+    void clear_band(std::uint32_t world, std::uint32_t band);
+
+  private:
+    inline std::size_t get_plane(std::uint32_t world, std::uint32_t channel) const { return static_cast<std::size_t>(world * 3 + channel) * m_plane_size; }
+    inline std::uint32_t get_cell(std::uint32_t x, std::uint32_t y) const { return (m_halo + x) + (m_halo + y) * m_padded_width; }
+
+    inline std::float_t store(std::float_t v) const { return engine::encode(v, m_storage); }
+
+    inline std::float_t load(const state& planes, std::size_t i) const { return planes.bits.empty() ? planes.values[i] : engine::widen(planes.bits[i], m_storage); }
+    inline void save(state& planes, std::size_t i, std::float_t v) const
+    {
+      if (planes.bits.empty()) planes.values[i] = store(v);
+      else planes.bits[i] = engine::narrow(v, m_storage);
+    }
+
+  private:
+    std::uint32_t m_system_width{};
+    std::uint32_t m_system_height{};
+
+    std::uint32_t m_generator_width{};
+    std::uint32_t m_generator_height{};
+
+    std::uint32_t m_world_count{};
+
+    std::vector<std::vector<slot>> m_sets{};
+    std::vector<std::uint32_t> m_world_sets{};
+
+    std::uint32_t m_halo{};
+    std::uint32_t m_padded_width{};
+    std::uint32_t m_padded_height{};
+    std::uint32_t m_plane_size{};
+    std::vector<std::uint32_t> m_wrap_x{};
+    std::vector<std::uint32_t> m_wrap_y{};
+
+    state m_front{};
+    state m_back{};
+    std::vector<std::float_t> m_generators{};
+
+    simd::isa m_isa{ simd::detect() };
+    engine::storage m_storage{ engine::e_storage_unorm8 };
+
+    bool m_skipping{ true };
+    std::uint32_t m_band_count{};
+    std::vector<std::uint8_t> m_front_active{};
+    std::vector<std::uint8_t> m_back_active{};
+    std::vector<std::uint8_t> m_next_active{};
+    std::vector<std::uint8_t> m_needed{};
+    std::vector<std::uint8_t> m_skippable{};
+    std::vector<std::uint32_t> m_active_bands{};
+
+    thread_pool m_pool;
+    std::vector<std::vector<std::float_t>> m_sums{};
+    std::vector<std::vector<std::float_t>> m_rows{};
+
+    std::uint64_t m_cells{};
+    std::uint64_t m_worlds{};
+    std::double_t m_seconds{};
+  };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,336 @@
+#include <cstdio>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <array>
+#include <memory>
+#include <cmath>
+#include <cfenv>
+#include <algorithm>
+
+#include <benchmark.h>
+#include <simd.h>
+#include <engine.h>
+
+namespace we
+{
+  // The per tap generator simd::generate_row replaced, kept to time and check against
+  static void compute_kernel_reference(kernel& kernel)
+  {
+    kernel.values.resize(kernel.size * kernel.size);
+
+    for (std::uint32_t i{}; i < kernel.size; i++)
+    {
+      for (std::uint32_t j{}; j < kernel.size; j++)
+      {
+        std::uint32_t idx{ i + j * kernel.size };
+
+        std::float_t h{ static_cast<std::float_t>(kernel.size) / 2.0f };
+        std::float_t x{ static_cast<std::float_t>(i) - (h - 0.5f) };
+        std::float_t y{ static_cast<std::float_t>(j) - (h - 0.5f) };
+        std::float_t l{ std::sqrt(x * x + y * y) };
+        std::float_t m{ l + kernel.offset };
+        std::float_t s{ std::sin((m * m) / kernel.distance) };
+        std::float_t v{ std::pow(s, static_cast<std::float_t>(kernel.sharpness)) };
+
+        if (v < 0.0f) v = 0.0f;
+        if (v > 1.0f) v = 1.0f;
+
+        if (std::fetestexcept(FE_DIVBYZERO)) v = 0.0f;
+        if (std::fetestexcept(FE_INVALID)) v = 0.0f;
+        if (std::fetestexcept(FE_OVERFLOW)) v = 0.0f;
+        if (std::fetestexcept(FE_UNDERFLOW)) v = 0.0f;
+
+        std::feclearexcept(FE_ALL_EXCEPT);
+
+        kernel.values[idx] = v;
+      }
+    }
+  }
+
+  void benchmark::convolution(std::uint32_t width, std::uint32_t height, std::uint32_t repeats)
+  {
+    static const std::uint32_t s_max_size{ 20 };
+
+    std::random_device random{};
+    std::mt19937 generator{ random() };
+    std::uniform_real_distribution<std::float_t> dist{ 0.0f, 1.0f };
+
+    std::uint32_t stride{ width + s_max_size };
+
+    std::vector<std::float_t> plane{};
+    std::vector<std::float_t> weights{};
+    std::vector<std::float_t> sums{};
+
+    plane.resize(stride * (height + s_max_size));
+    weights.resize(s_max_size * s_max_size);
+    sums.resize(width);
+
+    for (std::float_t& v : plane) v = dist(generator);
+    for (std::float_t& v : weights) v = dist(generator);
+
+    simd::isa best{ simd::detect() };
+
+    std::printf("Convolution %ux%u, %u repeats, ns per cell\n", width, height, repeats);
+    std::printf("%6s %10s %10s %10s %10s\n", "size", "scalar", "avx2", "avx512", "speedup");
+
+    for (std::uint32_t size{ 3 }; size <= s_max_size; size++)
+    {
+      std::array<std::double_t, 3> timings{};
+
+      for (std::uint32_t isa{}; isa <= best; isa++)
+      {
+        auto start{ std::chrono::steady_clock::now() };
+
+        for (std::uint32_t r{}; r < repeats; r++)
+        {
+          for (std::uint32_t y{}; y < height; y++)
+          {
+            simd::convolve_row(static_cast<simd::isa>(isa), &plane[y * stride], stride, &weights[0], size, &sums[0], width);
+          }
+        }
+
+        auto end{ std::chrono::steady_clock::now() };
+
+        timings[isa] = std::chrono::duration<std::double_t, std::nano>(end - start).count() / (static_cast<std::double_t>(width) * height * repeats);
+      }
+
+      std::printf("%6u %10.3f %10.3f %10.3f %9.2fx\n", size, timings[0], timings[1], timings[2], timings[0] / timings[best]);
+    }
+  }
+
+  void benchmark::tiling(std::uint32_t max_size, std::uint32_t repeats)
+  {
+    std::unordered_multimap<std::uint32_t, kernel> kernels{};
+
+    system::create_kernels(kernels);
+
+    for (auto& [channel, kernel] : kernels)
+    {
+      system::compute_kernel(kernel);
+    }
+
+    std::random_device random{};
+    std::mt19937 generator{ random() };
+    std::uniform_real_distribution<std::float_t> dist{ 0.0f, 1.0f };
+
+    std::uint32_t radius{};
+    for (const auto& [channel, kernel] : kernels)
+    {
+      radius = std::max(radius, kernel.size / 2);
+    }
+
+    std::printf("Tiling, L2 %u KiB, %u repeats, ns per cell and state bytes streamed per cell\n", simd::detect_l2_size() / 1024, repeats);
+    std::printf("%6s %6s %10s %10s %10s %10s %10s\n", "size", "tile", "untiled", "tiled", "speedup", "untiled B", "tiled B");
+
+    for (std::uint32_t size{ 256 }; size <= max_size; size *= 2)
+    {
+      std::vector<std::float_t> state{};
+
+      state.resize(size * size * 4);
+
+      for (std::float_t& v : state) v = dist(generator);
+
+      std::array<std::double_t, 2> timings{};
+      std::uint32_t tile{};
+
+      for (std::uint32_t tiled{}; tiled < 2; tiled++)
+      {
+        engine engine{ size, size, 0, 0, 1 };
+
+        engine.set_kernels(kernels);
+        engine.set_state(state);
+        engine.set_tiling(tiled);
+
+        for (std::uint32_t r{}; r < repeats; r++)
+        {
+          engine.step();
+        }
+
+        timings[tiled] = 1.0e9 / engine.get_cells_per_second();
+        tile = engine.get_tile();
+      }
+
+      // Untiled reads the interleaved state, then writes and rereads three padded planes.
+      // Tiled only reads the state, once per tile including the halo.
+      std::double_t padded{ static_cast<std::double_t>(size + radius * 2) * (size + radius * 2) / (static_cast<std::double_t>(size) * size) };
+      std::double_t gathered{ static_cast<std::double_t>(tile + radius * 2) * (tile + radius * 2) / (static_cast<std::double_t>(tile) * tile) };
+
+      std::printf("%6u %6u %10.3f %10.3f %9.2fx %10.1f %10.1f\n", size, tile, timings[0], timings[1], timings[0] / timings[1], 16.0 + 24.0 * padded, 16.0 * gathered);
+    }
+  }
+
+  void benchmark::generation(std::uint32_t shapes, std::uint32_t repeats)
+  {
+    static const std::uint32_t s_min_size{ 3 };
+    static const std::uint32_t s_max_size{ 50 };
+
+    std::random_device random{};
+    std::mt19937 generator{ random() };
+    std::uniform_real_distribution<std::float_t> offset_dist{ 0.0f, 100.0f };
+    std::uniform_real_distribution<std::float_t> distance_dist{ 50.0f, 500.0f };
+    std::uniform_int_distribution<std::uint32_t> sharpness_dist{ 1, 20 };
+
+    simd::isa best{ simd::detect() };
+
+    std::printf("Kernel generation, %u shapes, %u repeats, ns per tap and max difference to the per tap reference\n", shapes, repeats);
+    std::printf("%6s %10s %10s %10s %10s %10s %10s\n", "size", "reference", "scalar", "avx2", "avx512", "speedup", "max diff");
+
+    for (std::uint32_t size{ s_min_size }; size <= s_max_size; size++)
+    {
+      std::vector<kernel> kernels{};
+
+      kernels.resize(shapes);
+
+      for (kernel& kernel : kernels)
+      {
+        kernel.size = size;
+        kernel.offset = offset_dist(generator);
+        kernel.distance = distance_dist(generator);
+        kernel.sharpness = sharpness_dist(generator);
+      }
+
+      std::vector<std::float_t> values{};
+
+      values.resize(size * size);
+
+      std::float_t h{ static_cast<std::float_t>(size) / 2.0f };
+
+      std::array<std::double_t, 4> timings{};
+      std::double_t max{};
+
+      // Slot 0 is the reference, then one per instruction set
+      for (std::uint32_t path{}; path <= static_cast<std::uint32_t>(best) + 1; path++)
+      {
+        auto start{ std::chrono::steady_clock::now() };
+
+        for (std::uint32_t r{}; r < repeats; r++)
+        {
+          for (kernel& kernel : kernels)
+          {
+            if (path)
+            {
+              for (std::uint32_t j{}; j < size; j++)
+              {
+                simd::generate_row(static_cast<simd::isa>(path - 1), 0.0f - (h - 0.5f), static_cast<std::float_t>(j) - (h - 0.5f), kernel.offset, kernel.distance, kernel.sharpness, &values[j * size], size);
+              }
+            }
+            else
+            {
+              compute_kernel_reference(kernel);
+            }
+          }
+        }
+
+        auto end{ std::chrono::steady_clock::now() };
+
+        timings[path] = std::chrono::duration<std::double_t, std::nano>(end - start).count() / (static_cast<std::double_t>(size) * size * shapes * repeats);
+      }
+
+      // The reference values are left in the kernels from the first pass
+      for (std::uint32_t isa{}; isa <= best; isa++)
+      {
+        for (const kernel& kernel : kernels)
+        {
+          for (std::uint32_t j{}; j < size; j++)
+          {
+            simd::generate_row(static_cast<simd::isa>(isa), 0.0f - (h - 0.5f), static_cast<std::float_t>(j) - (h - 0.5f), kernel.offset, kernel.distance, kernel.sharpness, &values[j * size], size);
+          }
+
+          for (std::uint32_t i{}; i < values.size(); i++) max = std::max(max, static_cast<std::double_t>(std::fabs(values[i] - kernel.values[i])));
+        }
+      }
+
+      std::printf("%6u %10.3f %10.3f %10.3f %10.3f %9.2fx %10.2e\n", size, timings[0], timings[1], timings[2], timings[3], timings[0] / timings[static_cast<std::uint32_t>(best) + 1], max);
+    }
+  }
+
+  void benchmark::drift(std::uint32_t width, std::uint32_t height, std::uint32_t steps, std::uint32_t interval)
+  {
+    static const std::uint32_t s_generator_size{ 10 };
+
+    static const std::array<engine::storage, 3> s_storages{ engine::e_storage_half, engine::e_storage_bfloat, engine::e_storage_unorm8 };
+    static const std::array<const char*, 3> s_names{ "half", "bfloat", "unorm8" };
+
+    std::unordered_multimap<std::uint32_t, kernel> kernels{};
+
+    system::create_kernels(kernels);
+
+    for (auto& [channel, kernel] : kernels)
+    {
+      system::compute_kernel(kernel);
+    }
+
+    std::random_device random{};
+    std::mt19937 generator{ random() };
+    std::uniform_real_distribution<std::float_t> dist{ 0.0f, 1.0f };
+
+    std::vector<std::float_t> state{};
+    std::vector<std::float_t> seed{};
+    std::vector<std::float_t> baseline{};
+    std::vector<std::float_t> values{};
+
+    state.resize(width * height * 4);
+    seed.resize(s_generator_size * s_generator_size * 4);
+
+    for (std::float_t& v : state) v = dist(generator);
+    for (std::float_t& v : seed) v = dist(generator);
+
+    // Index 0 is the fp32 baseline, all of them accumulate in fp32
+    std::vector<std::unique_ptr<engine>> engines{};
+
+    for (std::uint32_t i{}; i <= s_storages.size(); i++)
+    {
+      engines.emplace_back(std::make_unique<engine>(width, height, s_generator_size, s_generator_size, 0));
+
+      engines[i]->set_storage(i ? s_storages[i - 1] : engine::e_storage_float);
+      engines[i]->set_kernels(kernels);
+      engines[i]->set_state(state);
+      engines[i]->set_generator(seed);
+    }
+
+    std::printf("Drift of rounding to each storage format against fp32, %ux%u, max and rms colour difference\n", width, height);
+    std::printf("%6s", "step");
+
+    for (std::uint32_t i{}; i < s_storages.size(); i++)
+    {
+      std::printf(" %7s max %7s rms", s_names[i], s_names[i]);
+    }
+
+    std::printf("\n");
+
+    for (std::uint32_t step{ 1 }; step <= steps; step++)
+    {
+      for (std::unique_ptr<engine>& engine : engines)
+      {
+        engine->step();
+      }
+
+      if (step % interval && step != steps) continue;
+
+      std::printf("%6u", step);
+
+      engines[0]->get_planes(baseline);
+
+      for (std::uint32_t i{ 1 }; i < engines.size(); i++)
+      {
+        engines[i]->get_planes(values);
+
+        std::double_t max{};
+        std::double_t sum{};
+
+        for (std::uint32_t j{}; j < values.size(); j++)
+        {
+          std::double_t e{ std::fabs(values[j] - baseline[j]) };
+
+          max = std::max(max, e);
+          sum += e * e;
+        }
+
+        std::printf(" %11.6f %11.6f", max, std::sqrt(sum / values.size()));
+      }
+
+      std::printf("\n");
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#ifndef WE_BENCHMARK_H
+#define WE_BENCHMARK_H
+
+#include <cstdint>
+
+namespace we
+{
+  class benchmark
+  {
+  public:
+    benchmark() = delete;
+
+  public:
+    static void convolution(std::uint32_t width, std::uint32_t height, std::uint32_t repeats);
+    static void tiling(std::uint32_t max_size, std::uint32_t repeats);
+    static void generation(std::uint32_t shapes, std::uint32_t repeats);
+    static void drift(std::uint32_t width, std::uint32_t height, std::uint32_t steps, std::uint32_t interval);
+  };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,44 @@
+#include <buffer.h>
+
+#include <glad/glad.h>
+
+namespace we
+{
+  void buffer::create_storage(std::uint32_t& buffer, const std::vector<std::float_t>& values)
+  {
+    create_storage(buffer, values.empty() ? nullptr : &values[0], values.size() * sizeof(std::float_t));
+  }
+
+  void buffer::create_storage(std::uint32_t& buffer, const void* data, std::uint64_t size)
+  {
+    glGenBuffers(1, &buffer);
+
+    update_storage(buffer, data, size);
+  }
+
+  void buffer::update_storage(std::uint32_t buffer, const std::vector<std::float_t>& values)
+  {
+    update_storage(buffer, values.empty() ? nullptr : &values[0], values.size() * sizeof(std::float_t));
+  }
+
+  void buffer::update_storage(std::uint32_t buffer, const void* data, std::uint64_t size)
+  {
+    // Respecified on every update since kernel sizes change the length
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  }
+
+  void buffer::update_storage_range(std::uint32_t buffer, std::uint64_t offset, const std::vector<std::float_t>& values)
+  {
+    // In place, the length is unchanged
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, values.size() * sizeof(std::float_t), &values[0]);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  }
+
+  void buffer::destroy(std::uint32_t buffer)
+  {
+    glDeleteBuffers(1, &buffer);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#ifndef WE_BUFFER_H
+#define WE_BUFFER_H
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+
+namespace we
+{
+  class buffer
+  {
+  public:
+    buffer() = delete;
+
+  public:
+    static void create_storage(std::uint32_t& buffer, const std::vector<std::float_t>& values);
+    static void create_storage(std::uint32_t& buffer, const void* data, std::uint64_t size);
+    static void update_storage(std::uint32_t buffer, const std::vector<std::float_t>& values);
+    static void update_storage(std::uint32_t buffer, const void* data, std::uint64_t size);
+    static void update_storage_range(std::uint32_t buffer, std::uint64_t offset, const std::vector<std::float_t>& values);
+
+    static void destroy(std::uint32_t buffer);
+  };
+}
+
+#endif
\ No newline at end of file
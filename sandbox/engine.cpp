@@ -0,0 +1,1054 @@
+#include <algorithm>
+#include <chrono>
+
+#include <engine.h>
+
+namespace we
+{
+  engine::engine(std::uint32_t system_width, std::uint32_t system_height, std::uint32_t generator_width, std::uint32_t generator_height, std::uint32_t thread_count)
+    : m_system_width{ system_width }
+    , m_system_height{ system_height }
+    , m_generator_width{ generator_width }
+    , m_generator_height{ generator_height }
+    , m_pool{ thread_count }
+  {
+    m_front.values.resize(m_system_width * m_system_height * 3);
+    m_back.values.resize(m_system_width * m_system_height * 3);
+    m_generator.resize(m_generator_width * m_generator_height * 3);
+
+    m_scratch.resize(m_pool.get_thread_count());
+
+    if (fft::is_supported(m_system_width, m_system_height))
+    {
+      m_fft = std::make_unique<fft>(m_system_width, m_system_height);
+    }
+  }
+
+  void engine::set_kernels(const std::unordered_multimap<std::uint32_t, kernel>& kernels)
+  {
+    m_slots.clear();
+
+    for (const auto& [channel, kernel] : kernels)
+    {
+      // Mirrors the hard-coded rm/gm/bm mixing in system::rebuild_shader
+      std::uint32_t index{ static_cast<std::uint32_t>(kernel.name.back() - '0') };
+
+      m_slots.emplace_back(slot{ kernel, (index + 3 - kernel.channel % 3) % 3 });
+    }
+
+    for (slot& slot : m_slots)
+    {
+      rebuild_slot(slot);
+    }
+
+    // Accumulate in the same order as the generated shader sums its terms
+    std::sort(m_slots.begin(), m_slots.end(), [](const slot& a, const slot& b)
+    {
+      return a.kernel.channel != b.kernel.channel ? a.kernel.channel < b.kernel.channel : a.kernel.name < b.kernel.name;
+    });
+
+    m_halo = 0;
+    m_radius = 0;
+    for (const slot& slot : m_slots)
+    {
+      m_halo = std::max(m_halo, slot.kernel.size);
+      m_radius = std::max(m_radius, slot.kernel.size / 2);
+    }
+
+    rebuild_wrap();
+  }
+
+  void engine::rebuild_slot(slot& slot)
+  {
+    const kernel& kernel{ slot.kernel };
+
+    slot.weights.resize(kernel.size * kernel.size);
+    slot.sums.resize(m_system_width * m_system_height);
+
+    for (std::uint32_t i{}; i < kernel.size * kernel.size; i++)
+    {
+      slot.weights[i] = kernel.values[i];
+    }
+
+    slot.dirty = 1;
+  }
+
+  void engine::rebuild_wrap()
+  {
+    m_wrap_x.resize(m_system_width + m_halo * 2);
+    m_wrap_y.resize(m_system_height + m_halo * 2);
+
+    for (std::uint32_t i{}; i < m_wrap_x.size(); i++)
+    {
+      std::int64_t x{ static_cast<std::int64_t>(i) - m_halo };
+      m_wrap_x[i] = static_cast<std::uint32_t>(((x % m_system_width) + m_system_width) % m_system_width);
+    }
+
+    for (std::uint32_t j{}; j < m_wrap_y.size(); j++)
+    {
+      std::int64_t y{ static_cast<std::int64_t>(j) - m_halo };
+      m_wrap_y[j] = static_cast<std::uint32_t>(((y % m_system_height) + m_system_height) % m_system_height);
+    }
+  }
+
+  void engine::set_kernel(const kernel& kernel)
+  {
+    for (slot& slot : m_slots)
+    {
+      if (slot.kernel.name == kernel.name && slot.kernel.channel == kernel.channel)
+      {
+        slot.kernel = kernel;
+
+        rebuild_slot(slot);
+      }
+    }
+
+    std::uint32_t halo{ m_halo };
+
+    m_radius = 0;
+    for (const slot& slot : m_slots)
+    {
+      halo = std::max(halo, slot.kernel.size);
+      m_radius = std::max(m_radius, slot.kernel.size / 2);
+    }
+
+    if (halo != m_halo)
+    {
+      m_halo = halo;
+
+      rebuild_wrap();
+    }
+  }
+
+  void engine::set_storage(storage storage)
+  {
+    if (storage == m_storage) return;
+
+    std::vector<std::float_t> values{};
+
+    get_planes(values);
+
+    m_storage = storage;
+
+    std::uint32_t size{ m_system_width * m_system_height * 3 };
+
+    // Only one representation is held, the back buffer is rewritten before it is read
+    for (state* planes : { &m_front, &m_back })
+    {
+      planes->values.assign(is_narrow(storage) ? 0 : size, 0.0f);
+      planes->bits.assign(is_narrow(storage) ? size : 0, 0);
+
+      planes->values.shrink_to_fit();
+      planes->bits.shrink_to_fit();
+    }
+
+    set_planes(values);
+  }
+
+  void engine::set_state(const std::vector<std::float_t>& values)
+  {
+    std::uint32_t cells{ m_system_width * m_system_height };
+
+    for (std::uint32_t c{}; c < 3; c++)
+    {
+      for (std::uint32_t i{}; i < cells; i++)
+      {
+        save(m_front, c * cells + i, values[i * 4 + c]);
+      }
+    }
+
+    m_activity_edge = 0;
+  }
+
+  void engine::set_planes(const std::vector<std::float_t>& values)
+  {
+    for (std::uint32_t i{}; i < m_system_width * m_system_height * 3; i++)
+    {
+      save(m_front, i, values[i]);
+    }
+
+    m_activity_edge = 0;
+  }
+
+  void engine::set_generator(const std::vector<std::float_t>& values)
+  {
+    std::uint32_t cells{ m_generator_width * m_generator_height };
+
+    for (std::uint32_t c{}; c < 3; c++)
+    {
+      for (std::uint32_t i{}; i < cells; i++)
+      {
+        m_generator[c * cells + i] = store(values[i * 4 + c]);
+      }
+    }
+  }
+
+  void engine::get_state(std::vector<std::float_t>& values) const
+  {
+    std::uint32_t cells{ m_system_width * m_system_height };
+
+    values.resize(cells * 4);
+
+    for (std::uint32_t i{}; i < cells; i++)
+    {
+      values[i * 4 + 0] = load(m_front, i);
+      values[i * 4 + 1] = load(m_front, cells + i);
+      values[i * 4 + 2] = load(m_front, cells * 2 + i);
+      values[i * 4 + 3] = 1.0f;
+    }
+  }
+
+  void engine::get_planes(std::vector<std::float_t>& values) const
+  {
+    values.resize(m_system_width * m_system_height * 3);
+
+    for (std::uint32_t i{}; i < values.size(); i++)
+    {
+      values[i] = load(m_front, i);
+    }
+  }
+
+  std::uint32_t engine::get_tile() const
+  {
+    if (m_tile) return m_tile;
+
+    // Three gathered channels should take about half of L2, the rest is left for weights and sums
+    std::uint32_t edge{ static_cast<std::uint32_t>(std::sqrt(static_cast<std::double_t>(m_l2_size) / (2 * 3 * sizeof(std::float_t)))) };
+    std::uint32_t tile{ (edge > m_radius * 2 + 16) ? ((edge - m_radius * 2) / 16) * 16 : 16 };
+
+    return std::min(tile, std::max(m_system_width, m_system_height));
+  }
+
+  void engine::advance(std::uint32_t steps)
+  {
+    while (steps)
+    {
+      std::uint32_t block{ std::min(steps, m_temporal) };
+
+      if (block > 1 && get_convolution() == e_conv_direct && get_tiling())
+      {
+        step_temporal(block);
+      }
+      else
+      {
+        step();
+
+        block = 1;
+      }
+
+      steps -= block;
+    }
+  }
+
+  void engine::step()
+  {
+    auto start{ std::chrono::steady_clock::now() };
+
+    if (get_convolution() == e_conv_fft)
+    {
+      convolve_fft();
+
+      m_pool.dispatch(m_system_height, 4, [this](std::uint32_t begin, std::uint32_t end) { step_rows(begin, end); });
+    }
+    else if (get_tiling())
+    {
+      step_tiles();
+    }
+    else
+    {
+      pad_channels();
+
+      if (m_lowrank)
+      {
+        filter_terms();
+      }
+
+      m_pool.dispatch(m_system_height, 4, [this](std::uint32_t begin, std::uint32_t end) { step_rows(begin, end); });
+    }
+
+    std::swap(m_front, m_back);
+
+    inject_generator();
+
+    if (get_convolution() == e_conv_direct && get_tiling())
+    {
+      std::swap(m_front_clear, m_back_clear);
+
+      mark_generator();
+    }
+    else
+    {
+      m_activity_edge = 0;
+    }
+
+    auto end{ std::chrono::steady_clock::now() };
+
+    m_cells += static_cast<std::uint64_t>(m_system_width) * m_system_height;
+    m_seconds += std::chrono::duration<std::double_t>(end - start).count();
+  }
+
+  void engine::convolve_fft()
+  {
+    std::uint32_t cells{ m_system_width * m_system_height };
+
+    // Forward transform each source channel once
+    m_pool.dispatch(3, 1, [&](std::uint32_t begin, std::uint32_t end)
+    {
+      for (std::uint32_t channel{ begin }; channel < end; channel++)
+      {
+        std::vector<fft::value>& spectrum{ m_spectra[channel] };
+
+        spectrum.resize(cells);
+
+        for (std::uint32_t i{}; i < cells; i++)
+        {
+          spectrum[i] = fft::value{ load(m_front, channel * cells + i), 0.0 };
+        }
+
+        m_fft->forward(spectrum);
+      }
+    });
+
+    // Multiply with the cached kernel spectra and transform back
+    m_pool.dispatch(static_cast<std::uint32_t>(m_slots.size()), 1, [&](std::uint32_t begin, std::uint32_t end)
+    {
+      for (std::uint32_t k{ begin }; k < end; k++)
+      {
+        slot& slot{ m_slots[k] };
+
+        if (slot.dirty)
+        {
+          transform_kernel(slot);
+        }
+
+        const std::vector<fft::value>& spectrum{ m_spectra[slot.kernel.channel] };
+
+        slot.product.resize(cells);
+
+        for (std::uint32_t i{}; i < cells; i++)
+        {
+          slot.product[i] = spectrum[i] * slot.spectrum[i];
+        }
+
+        m_fft->inverse(slot.product);
+
+        for (std::uint32_t i{}; i < cells; i++)
+        {
+          slot.sums[i] = static_cast<std::float_t>(slot.product[i].real());
+        }
+      }
+    });
+  }
+
+  void engine::transform_kernel(slot& slot)
+  {
+    const kernel& kernel{ slot.kernel };
+
+    slot.spectrum.assign(m_system_width * m_system_height, fft::value{});
+
+    // Place tap (i, j) at its texel offset so the product computes the same correlation
+    for (std::uint32_t i{}; i < kernel.size; i++)
+    {
+      for (std::uint32_t j{}; j < kernel.size; j++)
+      {
+        std::uint32_t x{ m_wrap_x[m_halo + i - kernel.size / 2] };
+        std::uint32_t y{ m_wrap_y[m_halo + j - kernel.size / 2] };
+
+        slot.spectrum[x + y * m_system_width] += kernel.values[i + j * kernel.size];
+      }
+    }
+
+    m_fft->forward(slot.spectrum);
+
+    for (fft::value& v : slot.spectrum)
+    {
+      v = std::conj(v);
+    }
+
+    slot.dirty = 0;
+  }
+
+  void engine::pad_channels()
+  {
+    std::uint32_t padded_height{ m_system_height + m_halo * 2 };
+
+    m_padded_width = m_system_width + m_halo * 2;
+
+    for (std::vector<std::float_t>& plane : m_padded)
+    {
+      plane.resize(m_padded_width * padded_height);
+    }
+
+    // Unwrap the torus once so every tap below is a plain contiguous load
+    m_pool.dispatch(padded_height, 16, [&](std::uint32_t begin, std::uint32_t end)
+    {
+      for (std::uint32_t c{}; c < 3; c++)
+      {
+        for (std::uint32_t j{ begin }; j < end; j++)
+        {
+          std::uint32_t row{ (c * m_system_height + m_wrap_y[j]) * m_system_width };
+
+          for (std::uint32_t i{}; i < m_padded_width; i++)
+          {
+            m_padded[c][i + j * m_padded_width] = load(m_front, row + m_wrap_x[i]);
+          }
+        }
+      }
+    });
+  }
+
+  void engine::convolve_rows(slot& slot, std::uint32_t row_begin, std::uint32_t row_end)
+  {
+    const kernel& kernel{ slot.kernel };
+    const std::vector<std::float_t>& plane{ m_padded[kernel.channel] };
+
+    if (m_lowrank && lowrank::is_worthwhile(kernel))
+    {
+      convolve_rows_lowrank(slot, row_begin, row_end);
+
+      return;
+    }
+
+    if (m_sparse)
+    {
+      convolve_rows_sparse(slot, row_begin, row_end);
+
+      return;
+    }
+
+    // Texel offset of the shader's `float(i) - size / 2.0` under nearest sampling
+    std::uint32_t origin{ m_halo - kernel.size / 2 };
+
+    for (std::uint32_t y{ row_begin }; y < row_end; y++)
+    {
+      const std::float_t* src{ &plane[origin + (origin + y) * m_padded_width] };
+
+      simd::convolve_row(m_isa, src, m_padded_width, &slot.weights[0], kernel.size, &slot.sums[y * m_system_width], m_system_width);
+    }
+  }
+
+  void engine::filter_terms()
+  {
+    for (slot& slot : m_slots)
+    {
+      const kernel& kernel{ slot.kernel };
+
+      if (!lowrank::is_worthwhile(kernel)) continue;
+
+      const std::vector<std::float_t>& plane{ m_padded[kernel.channel] };
+
+      std::uint32_t origin{ m_halo - kernel.size / 2 };
+      std::uint32_t height{ m_system_height + kernel.size - 1 };
+
+      slot.terms.resize(kernel.rank * height * m_system_width);
+
+      // Horizontal pass over every source row once, one plane per term
+      m_pool.dispatch(height, 16, [&](std::uint32_t begin, std::uint32_t end)
+      {
+        for (std::uint32_t r{}; r < kernel.rank; r++)
+        {
+          const std::float_t* w{ &kernel.rows[r * kernel.size] };
+
+          for (std::uint32_t b{ begin }; b < end; b++)
+          {
+            const std::float_t* src{ &plane[origin + (origin + b) * m_padded_width] };
+            std::float_t* dst{ &slot.terms[(r * height + b) * m_system_width] };
+
+            std::fill_n(dst, m_system_width, 0.0f);
+
+            for (std::uint32_t i{}; i < kernel.size; i++)
+            {
+              for (std::uint32_t x{}; x < m_system_width; x++)
+              {
+                dst[x] += w[i] * src[x + i];
+              }
+            }
+          }
+        }
+      });
+    }
+  }
+
+  void engine::convolve_rows_lowrank(slot& slot, std::uint32_t row_begin, std::uint32_t row_end)
+  {
+    const kernel& kernel{ slot.kernel };
+
+    std::uint32_t height{ m_system_height + kernel.size - 1 };
+
+    // Vertical pass folds the terms back into the kernel sums
+    for (std::uint32_t y{ row_begin }; y < row_end; y++)
+    {
+      std::float_t* dst{ &slot.sums[y * m_system_width] };
+
+      std::fill_n(dst, m_system_width, 0.0f);
+
+      for (std::uint32_t r{}; r < kernel.rank; r++)
+      {
+        for (std::uint32_t j{}; j < kernel.size; j++)
+        {
+          std::float_t c{ kernel.cols[r * kernel.size + j] };
+          const std::float_t* src{ &slot.terms[(r * height + y + j) * m_system_width] };
+
+          for (std::uint32_t x{}; x < m_system_width; x++)
+          {
+            dst[x] += c * src[x];
+          }
+        }
+      }
+    }
+  }
+
+  void engine::convolve_rows_sparse(slot& slot, std::uint32_t row_begin, std::uint32_t row_end)
+  {
+    const kernel& kernel{ slot.kernel };
+    const std::vector<std::float_t>& plane{ m_padded[kernel.channel] };
+
+    // Gather in tap order so each cell sums exactly like the unrolled shader taps
+    for (std::uint32_t y{ row_begin }; y < row_end; y++)
+    {
+      std::float_t* dst{ &slot.sums[y * m_system_width] };
+
+      std::fill_n(dst, m_system_width, 0.0f);
+
+      for (const tap& tap : kernel.taps)
+      {
+        const std::float_t* src{ &plane[(m_halo + tap.dx) + (m_halo + y + tap.dy) * m_padded_width] };
+
+        for (std::uint32_t x{}; x < m_system_width; x++)
+        {
+          dst[x] += tap.weight * src[x];
+        }
+      }
+    }
+  }
+
+  void engine::step_rows(std::uint32_t row_begin, std::uint32_t row_end)
+  {
+    if (get_convolution() == e_conv_direct)
+    {
+      for (slot& slot : m_slots)
+      {
+        convolve_rows(slot, row_begin, row_end);
+      }
+    }
+
+    std::vector<const std::float_t*>& sums{ m_scratch[m_pool.get_worker()].sums };
+
+    sums.resize(m_slots.size());
+
+    for (std::uint32_t y{ row_begin }; y < row_end; y++)
+    {
+      for (std::uint32_t s{}; s < m_slots.size(); s++)
+      {
+        sums[s] = &m_slots[s].sums[y * m_system_width];
+      }
+
+      mix_row(y, 0, m_system_width, &sums[0]);
+    }
+  }
+
+  void engine::step_tiles()
+  {
+    std::uint32_t edge{ get_tile() };
+    std::uint32_t tiles{ ((m_system_width + edge - 1) / edge) * ((m_system_height + edge - 1) / edge) };
+
+    if (m_activity_edge != edge)
+    {
+      rebuild_activity(edge);
+    }
+
+    bool skippable{ is_skippable() };
+
+    if (skippable)
+    {
+      dilate_activity();
+    }
+
+    // Written by one tile each, so plain bytes are enough
+    std::vector<std::uint8_t>& active{ m_next_active };
+
+    active.assign(tiles, 0);
+
+    m_pool.dispatch(tiles, 1, [&](std::uint32_t begin, std::uint32_t end)
+    {
+      scratch& scratch{ m_scratch[m_pool.get_worker()] };
+
+      for (std::uint32_t t{ begin }; t < end; t++)
+      {
+        if (!skippable || m_needed[t])
+        {
+          active[t] = step_tile(t, scratch);
+        }
+        else if (!m_back_clear[t])
+        {
+          clear_tile(t);
+        }
+
+        m_back_clear[t] = !active[t];
+      }
+    });
+
+    m_active_tiles = skippable ? static_cast<std::uint32_t>(std::count(m_needed.begin(), m_needed.end(), 1)) : tiles;
+
+    std::swap(m_front_active, m_next_active);
+  }
+
+  bool engine::is_skippable() const
+  {
+    if (!m_skipping) return false;
+
+    // A dead neighbourhood then adds `time * 0 / g`, exactly zero, to every channel
+    for (const slot& slot : m_slots)
+    {
+      const kernel& kernel{ slot.kernel };
+
+      std::float_t g{ grow(kernel, 0.0f) };
+
+      if (!std::isfinite(g) || g == 0.0f || !std::isfinite(kernel.time)) return false;
+    }
+
+    return true;
+  }
+
+  engine::rect engine::get_tile_rect(std::uint32_t tile) const
+  {
+    std::uint32_t edge{ get_tile() };
+    std::uint32_t columns{ (m_system_width + edge - 1) / edge };
+
+    std::uint32_t x{ (tile % columns) * edge };
+    std::uint32_t y{ (tile / columns) * edge };
+
+    return rect{ x, y, std::min(edge, m_system_width - x), std::min(edge, m_system_height - y) };
+  }
+
+  bool engine::is_zero(const state& planes, const rect& rect) const
+  {
+    for (std::uint32_t c{}; c < 3; c++)
+    {
+      for (std::uint32_t y{ rect.y }; y < rect.y + rect.height; y++)
+      {
+        std::uint32_t row{ rect.x + (c * m_system_height + y) * m_system_width };
+
+        for (std::uint32_t x{}; x < rect.width; x++)
+        {
+          if (load(planes, row + x) != 0.0f) return false;
+        }
+      }
+    }
+
+    return true;
+  }
+
+  void engine::rebuild_activity(std::uint32_t edge)
+  {
+    std::uint32_t tiles{ ((m_system_width + edge - 1) / edge) * ((m_system_height + edge - 1) / edge) };
+
+    m_activity_edge = edge;
+    m_tile_count = tiles;
+
+    m_front_active.resize(tiles);
+    m_front_clear.assign(tiles, 0);
+    m_back_clear.assign(tiles, 0);
+    m_needed.resize(tiles);
+
+    for (std::uint32_t t{}; t < tiles; t++)
+    {
+      m_front_active[t] = !is_zero(m_front, get_tile_rect(t));
+    }
+  }
+
+  void engine::dilate_activity()
+  {
+    std::uint32_t edge{ m_activity_edge };
+    std::uint32_t columns{ (m_system_width + edge - 1) / edge };
+
+    std::fill(m_needed.begin(), m_needed.end(), 0);
+
+    // Tiles whose cells lie within m_radius of an active one, wrapping like the taps
+    auto reach{ [&](std::uint32_t begin, std::uint32_t end, std::uint32_t size, std::vector<std::uint32_t>& out)
+    {
+      out.clear();
+
+      std::int64_t first{ static_cast<std::int64_t>(begin) - m_radius };
+      std::int64_t last{ static_cast<std::int64_t>(end) + m_radius };
+
+      if (last - first >= size)
+      {
+        for (std::uint32_t i{}; i < (size + edge - 1) / edge; i++) out.emplace_back(i);
+
+        return;
+      }
+
+      for (std::int64_t c{ first }; c < last;)
+      {
+        std::uint32_t cell{ static_cast<std::uint32_t>(((c % size) + size) % size) };
+        std::uint32_t index{ cell / edge };
+
+        out.emplace_back(index);
+
+        c += std::min((index + 1) * edge, size) - cell;
+      }
+    } };
+
+    for (std::uint32_t t{}; t < m_tile_count; t++)
+    {
+      if (!m_front_active[t]) continue;
+
+      rect rect{ get_tile_rect(t) };
+
+      reach(rect.x, rect.x + rect.width, m_system_width, m_near_x);
+      reach(rect.y, rect.y + rect.height, m_system_height, m_near_y);
+
+      for (std::uint32_t ty : m_near_y)
+      {
+        for (std::uint32_t tx : m_near_x)
+        {
+          m_needed[tx + ty * columns] = 1;
+        }
+      }
+    }
+  }
+
+  void engine::clear_tile(std::uint32_t tile)
+  {
+    rect rect{ get_tile_rect(tile) };
+
+    for (std::uint32_t c{}; c < 3; c++)
+    {
+      for (std::uint32_t y{ rect.y }; y < rect.y + rect.height; y++)
+      {
+        std::uint32_t row{ rect.x + (c * m_system_height + y) * m_system_width };
+
+        if (m_back.bits.empty()) std::fill_n(&m_back.values[row], rect.width, 0.0f);
+        else std::fill_n(&m_back.bits[row], rect.width, std::uint16_t{});
+      }
+    }
+  }
+
+  void engine::mark_generator()
+  {
+    std::uint32_t edge{ m_activity_edge };
+    std::uint32_t columns{ (m_system_width + edge - 1) / edge };
+
+    std::uint32_t offset_x{ m_system_width / 2 };
+    std::uint32_t offset_y{ m_system_height / 2 };
+
+    std::uint32_t width{ std::min(m_generator_width, m_system_width - offset_x) };
+    std::uint32_t height{ std::min(m_generator_height, m_system_height - offset_y) };
+
+    if (!width || !height) return;
+
+    for (std::uint32_t ty{ offset_y / edge }; ty <= (offset_y + height - 1) / edge; ty++)
+    {
+      for (std::uint32_t tx{ offset_x / edge }; tx <= (offset_x + width - 1) / edge; tx++)
+      {
+        m_front_active[tx + ty * columns] = 1;
+        m_front_clear[tx + ty * columns] = 0;
+      }
+    }
+  }
+
+  bool engine::step_tile(std::uint32_t tile, scratch& scratch)
+  {
+    auto [x_begin, y_begin, width, height] { get_tile_rect(tile) };
+
+    std::uint32_t stride{ width + m_radius * 2 };
+    std::uint32_t plane_size{ stride * (height + m_radius * 2) };
+
+    scratch.values.resize(plane_size * 3 + m_slots.size() * width * s_tile_rows);
+    scratch.sums.resize(m_slots.size());
+
+    std::array<std::float_t*, 3> planes{ &scratch.values[0], &scratch.values[plane_size], &scratch.values[plane_size * 2] };
+    std::float_t* band_sums{ &scratch.values[plane_size * 3] };
+    const std::float_t** sums{ scratch.sums.data() };
+
+    // Gather the tile and its halo once, the wrap tables reach m_halo >= m_radius cells out
+    for (std::uint32_t c{}; c < 3; c++)
+    {
+      for (std::uint32_t j{}; j < height + m_radius * 2; j++)
+      {
+        std::uint32_t row{ (c * m_system_height + m_wrap_y[m_halo + y_begin + j - m_radius]) * m_system_width };
+        const std::uint32_t* wrap{ &m_wrap_x[m_halo + x_begin - m_radius] };
+
+        for (std::uint32_t i{}; i < stride; i++)
+        {
+          planes[c][i + j * stride] = load(m_front, row + wrap[i]);
+        }
+      }
+    }
+
+    // A few rows per kernel at a time keep its taps and source rows in L1
+    for (std::uint32_t band{}; band < height; band += s_tile_rows)
+    {
+      std::uint32_t rows{ std::min(s_tile_rows, height - band) };
+
+      for (std::uint32_t s{}; s < m_slots.size(); s++)
+      {
+        const kernel& kernel{ m_slots[s].kernel };
+
+        std::uint32_t origin{ m_radius - kernel.size / 2 };
+
+        for (std::uint32_t y{}; y < rows; y++)
+        {
+          simd::convolve_row(m_isa, &planes[kernel.channel][origin + (origin + band + y) * stride], stride, &m_slots[s].weights[0], kernel.size, &band_sums[(s * s_tile_rows + y) * width], width);
+        }
+      }
+
+      for (std::uint32_t y{}; y < rows; y++)
+      {
+        for (std::uint32_t s{}; s < m_slots.size(); s++)
+        {
+          sums[s] = &band_sums[(s * s_tile_rows + y) * width];
+        }
+
+        mix_row(y_begin + band + y, x_begin, x_begin + width, sums);
+      }
+    }
+
+    return !is_zero(m_back, get_tile_rect(tile));
+  }
+
+  void engine::step_temporal(std::uint32_t steps)
+  {
+    auto start{ std::chrono::steady_clock::now() };
+
+    std::uint32_t tile{ get_tile() };
+    std::uint32_t tiles{ ((m_system_width + tile - 1) / tile) * ((m_system_height + tile - 1) / tile) };
+
+    m_pool.dispatch(tiles, 1, [&](std::uint32_t begin, std::uint32_t end)
+    {
+      scratch& scratch{ m_scratch[m_pool.get_worker()] };
+
+      for (std::uint32_t t{ begin }; t < end; t++)
+      {
+        step_block(t, steps, scratch);
+      }
+    });
+
+    std::swap(m_front, m_back);
+
+    inject_generator();
+
+    m_activity_edge = 0;
+
+    auto end{ std::chrono::steady_clock::now() };
+
+    m_cells += static_cast<std::uint64_t>(m_system_width) * m_system_height * steps;
+    m_seconds += std::chrono::duration<std::double_t>(end - start).count();
+  }
+
+  void engine::step_block(std::uint32_t tile, std::uint32_t steps, scratch& scratch)
+  {
+    auto [x_begin, y_begin, width, height] { get_tile_rect(tile) };
+
+    // Every step needs m_radius more cells around the ones it produces
+    std::uint32_t extent{ steps * m_radius };
+    std::uint32_t stride{ width + extent * 2 };
+    std::uint32_t rows{ height + extent * 2 };
+    std::uint32_t plane_size{ stride * rows };
+
+    scratch.values.resize(plane_size * 6 + m_slots.size() * stride * s_tile_rows);
+    scratch.sums.resize(m_slots.size());
+
+    std::array<std::float_t*, 3> src{ &scratch.values[0], &scratch.values[plane_size], &scratch.values[plane_size * 2] };
+    std::array<std::float_t*, 3> dst{ &scratch.values[plane_size * 3], &scratch.values[plane_size * 4], &scratch.values[plane_size * 5] };
+    std::float_t* band_sums{ &scratch.values[plane_size * 6] };
+    const std::float_t** sums{ scratch.sums.data() };
+
+    // The extent can be wider than the world, so wrap with a modulo instead of the tables
+    std::int64_t origin_x{ static_cast<std::int64_t>(x_begin) - extent };
+    std::int64_t origin_y{ static_cast<std::int64_t>(y_begin) - extent };
+
+    auto wrap_x{ [&](std::uint32_t i) { return static_cast<std::uint32_t>((((origin_x + i) % m_system_width) + m_system_width) % m_system_width); } };
+    auto wrap_y{ [&](std::uint32_t j) { return static_cast<std::uint32_t>((((origin_y + j) % m_system_height) + m_system_height) % m_system_height); } };
+
+    for (std::uint32_t c{}; c < 3; c++)
+    {
+      for (std::uint32_t j{}; j < rows; j++)
+      {
+        std::uint32_t row{ (c * m_system_height + wrap_y(j)) * m_system_width };
+
+        for (std::uint32_t i{}; i < stride; i++)
+        {
+          src[c][i + j * stride] = load(m_front, row + wrap_x(i));
+        }
+      }
+    }
+
+    std::uint32_t generator_x{ m_system_width / 2 };
+    std::uint32_t generator_y{ m_system_height / 2 };
+    std::uint32_t generator_width{ std::min(m_generator_width, m_system_width - generator_x) };
+    std::uint32_t generator_height{ std::min(m_generator_height, m_system_height - generator_y) };
+
+    // Each step shrinks the valid region by m_radius on every side, the last one leaves the tile
+    for (std::uint32_t step{ 1 }; step <= steps; step++)
+    {
+      std::uint32_t inset{ step * m_radius };
+      std::uint32_t count{ stride - inset * 2 };
+
+      for (std::uint32_t band{ inset }; band < rows - inset; band += s_tile_rows)
+      {
+        std::uint32_t band_rows{ std::min(s_tile_rows, rows - inset - band) };
+
+        for (std::uint32_t s{}; s < m_slots.size(); s++)
+        {
+          const kernel& kernel{ m_slots[s].kernel };
+
+          std::uint32_t corner{ inset - kernel.size / 2 };
+
+          for (std::uint32_t y{}; y < band_rows; y++)
+          {
+            simd::convolve_row(m_isa, &src[kernel.channel][corner + (band + y - kernel.size / 2) * stride], stride, &m_slots[s].weights[0], kernel.size, &band_sums[(s * s_tile_rows + y) * stride], count);
+          }
+        }
+
+        for (std::uint32_t y{}; y < band_rows; y++)
+        {
+          for (std::uint32_t s{}; s < m_slots.size(); s++)
+          {
+            sums[s] = &band_sums[(s * s_tile_rows + y) * stride];
+          }
+
+          std::uint32_t offset{ inset + (band + y) * stride };
+
+          mix_cells(sums, { src[0] + offset, src[1] + offset, src[2] + offset }, { dst[0] + offset, dst[1] + offset, dst[2] + offset }, count);
+        }
+      }
+
+      // Same as inject_generator after every single step
+      for (std::uint32_t j{ inset }; j < rows - inset; j++)
+      {
+        std::uint32_t gy{ wrap_y(j) - generator_y };
+        if (wrap_y(j) < generator_y || gy >= generator_height) continue;
+
+        for (std::uint32_t i{ inset }; i < stride - inset; i++)
+        {
+          std::uint32_t gx{ wrap_x(i) - generator_x };
+          if (wrap_x(i) < generator_x || gx >= generator_width) continue;
+
+          std::uint32_t cell{ gx + gy * m_generator_width };
+
+          dst[0][i + j * stride] = get_plane(m_generator, 0)[cell];
+          dst[1][i + j * stride] = get_plane(m_generator, 1)[cell];
+          dst[2][i + j * stride] = get_plane(m_generator, 2)[cell];
+        }
+      }
+
+      std::swap(src, dst);
+    }
+
+    for (std::uint32_t c{}; c < 3; c++)
+    {
+      for (std::uint32_t y{}; y < height; y++)
+      {
+        const std::float_t* values{ &src[c][extent + (extent + y) * stride] };
+        std::uint32_t row{ x_begin + (c * m_system_height + y_begin + y) * m_system_width };
+
+        if (m_back.bits.empty())
+        {
+          std::copy_n(values, width, &m_back.values[row]);
+
+          continue;
+        }
+
+        for (std::uint32_t x{}; x < width; x++)
+        {
+          m_back.bits[row + x] = narrow(values[x], m_storage);
+        }
+      }
+    }
+  }
+
+  void engine::mix_row(std::uint32_t y, std::uint32_t x_begin, std::uint32_t x_end, const std::float_t* const* sums)
+  {
+    std::uint32_t idx{ x_begin + y * m_system_width };
+
+    if (m_front.bits.empty())
+    {
+      mix_cells(sums, { get_plane(m_front.values, 0) + idx, get_plane(m_front.values, 1) + idx, get_plane(m_front.values, 2) + idx }, { get_plane(m_back.values, 0) + idx, get_plane(m_back.values, 1) + idx, get_plane(m_back.values, 2) + idx }, x_end - x_begin);
+
+      return;
+    }
+
+    // 16 bit states mix a widened copy of the row and narrow the result back
+    std::uint32_t count{ x_end - x_begin };
+    std::uint32_t cells{ m_system_width * m_system_height };
+
+    std::vector<std::float_t>& row{ m_scratch[m_pool.get_worker()].row };
+
+    row.resize(count * 6);
+
+    for (std::uint32_t c{}; c < 3; c++)
+    {
+      for (std::uint32_t x{}; x < count; x++)
+      {
+        row[c * count + x] = widen(m_front.bits[c * cells + idx + x], m_storage);
+      }
+    }
+
+    mix_cells(sums, { &row[0], &row[count], &row[count * 2] }, { &row[count * 3], &row[count * 4], &row[count * 5] }, count);
+
+    for (std::uint32_t c{}; c < 3; c++)
+    {
+      for (std::uint32_t x{}; x < count; x++)
+      {
+        m_back.bits[c * cells + idx + x] = narrow(row[(c + 3) * count + x], m_storage);
+      }
+    }
+  }
+
+  void engine::mix_cells(const std::float_t* const* sums, const std::array<const std::float_t*, 3>& src, const std::array<std::float_t*, 3>& dst, std::uint32_t count)
+  {
+    for (std::uint32_t x{}; x < count; x++)
+    {
+      std::array<std::float_t, 3> mix{ src[0][x], src[1][x], src[2][x] };
+
+      for (std::uint32_t s{}; s < m_slots.size(); s++)
+      {
+        const kernel& kernel{ m_slots[s].kernel };
+
+        std::float_t sum{ sums[s][x] };
+
+        std::float_t g{ grow(kernel, sum) };
+        std::float_t avg{ sum / static_cast<std::float_t>(kernel.size * kernel.size) };
+
+        mix[m_slots[s].target] += kernel.time * avg / g;
+      }
+
+      dst[0][x] = store(mix[0]);
+      dst[1][x] = store(mix[1]);
+      dst[2][x] = store(mix[2]);
+    }
+  }
+
+  void engine::inject_generator()
+  {
+    std::uint32_t offset_x{ m_system_width / 2 };
+    std::uint32_t offset_y{ m_system_height / 2 };
+
+    std::uint32_t width{ std::min(m_generator_width, m_system_width - offset_x) };
+    std::uint32_t height{ std::min(m_generator_height, m_system_height - offset_y) };
+
+    for (std::uint32_t c{}; c < 3; c++)
+    {
+      const std::float_t* src{ get_plane(m_generator, c) };
+
+      for (std::uint32_t j{}; j < height; j++)
+      {
+        std::uint32_t row{ offset_x + (c * m_system_height + offset_y + j) * m_system_width };
+
+        if (m_front.bits.empty())
+        {
+          std::copy_n(&src[j * m_generator_width], width, &m_front.values[row]);
+
+          continue;
+        }
+
+        for (std::uint32_t i{}; i < width; i++)
+        {
+          m_front.bits[row + i] = narrow(src[j * m_generator_width + i], m_storage);
+        }
+      }
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,350 @@
+#ifndef WE_ENGINE_H
+#define WE_ENGINE_H
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <array>
+#include <memory>
+#include <algorithm>
+#include <unordered_map>
+#include <bit>
+
+#include <system.h>
+#include <thread_pool.h>
+#include <fft.h>
+#include <simd.h>
+#include <lowrank.h>
+
+namespace we
+{
+  // Headless CPU counterpart of the program generated by system::rebuild_shader.
+  // State is planar, one plane per colour channel and no alpha, so every convolution
+  // streams a single channel. set_planes and get_planes take that layout directly, which
+  // glReadPixels produces with GL_RED, GL_GREEN and GL_BLUE, while set_state and
+  // get_state convert from and to interleaved RGBA. Taps wrap toroidally like GL_REPEAT.
+  //
+  // The direct path pads each channel once per step and convolves whole rows with the
+  // widest instruction set simd::detect reports, 8 or 16 cells per instruction.
+  //
+  // With set_tiling, the default, the direct path skips the padded planes and walks square tiles.
+  // Each tile is gathered once from the state with a halo of half the widest kernel, every
+  // kernel runs on it while it is cached, and growth and mixing are applied before anything
+  // is written. The edge is sized from simd::detect_l2_size unless set_tile fixes it. The
+  // low rank and sparse paths still use the padded planes.
+  //
+  // The tiled path keeps a bitmap of tiles holding any nonzero colour. Tiles with no active
+  // tile within the widest radius are not convolved, since every kernel then adds exactly
+  // zero, and their output is only written when the buffer does not already hold zeros.
+  // That needs every growth at zero to be finite and nonzero, otherwise `0 / g` is not zero
+  // and everything is stepped. get_active_tiles reports how many tiles the last step ran.
+  //
+  // advance with set_temporal above one runs that many steps on each tile before moving on.
+  // The tile is gathered with a halo of steps * radius and every step recomputes a ring
+  // that shrinks by one radius, so neighbouring tiles redo the overlap instead of waiting
+  // on each other. Cells see exactly the inputs and order of single steps, so the result
+  // is bit identical, generator included.
+  //
+  // With set_lowrank the direct path uses the separable terms from lowrank::factor for
+  // every kernel where that is cheaper, costing 2 * size * rank instead of size * size.
+  //
+  // With set_sparse the direct path walks the tap lists from sparse::gather instead,
+  // skipping every weight at or below the cutoff.
+  //
+  // With set_growth_table the growth comes from system::bump_table, interpolated from
+  // growth_table like the program generated with the table, instead of system::bump.
+  //
+  // The FFT path transforms every channel once per step and shares that spectrum
+  // between all kernels reading it. Kernel spectra are cached until set_kernel or
+  // set_kernels marks them dirty. It needs power of two world sizes and falls back
+  // to the direct path otherwise.
+  //
+  // The unorm8 textures store 8 bits per channel, so results are rounded to the same
+  // 1/255 steps by default. set_storage rounds to half or bfloat16 instead, or keeps
+  // full floats; sums always accumulate in fp32. Half and bfloat16 states are held in
+  // 16 bits per value and widened to fp32 when tiles and rows are gathered, the other
+  // modes keep fp32 planes. A single step then agrees with the GPU within s_tolerance,
+  // one step, per channel. Cells differ when summation order or the driver's division
+  // precision move a value across a rounding boundary, which happens more often where
+  // the growth value is close to zero since `_avg / _g` amplifies it.
+  class engine
+  {
+  public:
+    enum convolution
+    {
+      e_conv_direct,
+      e_conv_fft,
+    };
+
+    // What every stored value is rounded to, matching the render target formats
+    enum storage
+    {
+      e_storage_unorm8,
+      e_storage_half,
+      e_storage_bfloat,
+      e_storage_float,
+    };
+
+  public:
+    inline static const std::float_t s_tolerance{ 1.0f / 255.0f + 1.0e-6f };
+    inline static const std::uint32_t s_tile_rows{ 4 };
+
+  public:
+    engine(std::uint32_t system_width, std::uint32_t system_height, std::uint32_t generator_width, std::uint32_t generator_height, std::uint32_t thread_count);
+
+  public:
+    inline std::uint32_t get_thread_count() const { return m_pool.get_thread_count(); }
+    inline const thread_pool& get_pool() const { return m_pool; }
+    inline std::double_t get_cells_per_second() const { return m_seconds > 0.0 ? static_cast<std::double_t>(m_cells) / m_seconds : 0.0; }
+
+    inline void set_convolution(convolution convolution) { m_convolution = convolution; }
+    inline convolution get_convolution() const { return m_fft ? m_convolution : e_conv_direct; }
+
+    inline void set_isa(simd::isa isa) { m_isa = std::min(isa, simd::detect()); }
+    inline simd::isa get_isa() const { return m_isa; }
+
+    void set_storage(storage storage);
+    inline storage get_storage() const { return m_storage; }
+
+    inline void set_lowrank(bool lowrank) { m_lowrank = lowrank; }
+    inline bool get_lowrank() const { return m_lowrank; }
+
+    inline void set_sparse(bool sparse) { m_sparse = sparse; }
+    inline bool get_sparse() const { return m_sparse; }
+
+    inline void set_tiling(bool tiling) { m_tiling = tiling; }
+    inline bool get_tiling() const { return m_tiling && !m_lowrank && !m_sparse; }
+
+    // Zero picks the edge from the cache size
+    inline void set_tile(std::uint32_t tile) { m_tile = tile; }
+    std::uint32_t get_tile() const;
+
+    inline void set_skipping(bool skipping) { m_skipping = skipping; }
+    inline bool get_skipping() const { return m_skipping; }
+    inline std::uint32_t get_active_tiles() const { return m_active_tiles; }
+    inline std::uint32_t get_tile_count() const { return m_tile_count; }
+
+    inline void set_temporal(std::uint32_t steps) { m_temporal = std::max(steps, 1u); }
+    inline std::uint32_t get_temporal() const { return m_temporal; }
+
+    inline void set_growth_table(bool growth_table) { m_growth_table = growth_table; }
+    inline bool get_growth_table() const { return m_growth_table; }
+
+  public:
+    void set_kernels(const std::unordered_multimap<std::uint32_t, kernel>& kernels);
+    void set_kernel(const kernel& kernel);
+    void set_state(const std::vector<std::float_t>& values);
+    void set_planes(const std::vector<std::float_t>& values);
+    void set_generator(const std::vector<std::float_t>& values);
+    void get_state(std::vector<std::float_t>& values) const;
+    void get_planes(std::vector<std::float_t>& values) const;
+
+  public:
+    void step();
+    void advance(std::uint32_t steps);
+
+  private:
+    struct slot
+    {
+      we::kernel kernel{};
+      std::uint32_t target{};
+      std::uint32_t dirty{ 1 };
+      std::vector<std::float_t> weights{};
+      std::vector<fft::value> spectrum{};
+      std::vector<fft::value> product{};
+      std::vector<std::float_t> sums{};
+      std::vector<std::float_t> terms{};
+    };
+
+    // Per worker, grown on first use and reused by every step after that
+    struct scratch
+    {
+      std::vector<std::float_t> values{};
+      std::vector<const std::float_t*> sums{};
+      std::vector<std::float_t> row{};
+    };
+
+    // Three planes in fp32, or in 16 bits for half and bfloat16 with values left empty
+    struct state
+    {
+      std::vector<std::float_t> values{};
+      std::vector<std::uint16_t> bits{};
+    };
+
+    struct rect
+    {
+      std::uint32_t x{};
+      std::uint32_t y{};
+      std::uint32_t width{};
+      std::uint32_t height{};
+    };
+
+  private:
+    void rebuild_slot(slot& slot);
+    void rebuild_wrap();
+
+  private:
+    void convolve_fft();
+    void transform_kernel(slot& slot);
+
+  private:
+    void pad_channels();
+    void convolve_rows(slot& slot, std::uint32_t row_begin, std::uint32_t row_end);
+    void filter_terms();
+    void convolve_rows_lowrank(slot& slot, std::uint32_t row_begin, std::uint32_t row_end);
+    void convolve_rows_sparse(slot& slot, std::uint32_t row_begin, std::uint32_t row_end);
+    void step_rows(std::uint32_t row_begin, std::uint32_t row_end);
+    void step_tiles();
+    bool step_tile(std::uint32_t tile, scratch& scratch);
+    void step_temporal(std::uint32_t steps);
+    void step_block(std::uint32_t tile, std::uint32_t steps, scratch& scratch);
+    void mix_row(std::uint32_t y, std::uint32_t x_begin, std::uint32_t x_end, const std::float_t* const* sums);
+    void mix_cells(const std::float_t* const* sums, const std::array<const std::float_t*, 3>& src, const std::array<std::float_t*, 3>& dst, std::uint32_t count);
+    void inject_generator();
+
+  private:
+    bool is_skippable() const;
+    rect get_tile_rect(std::uint32_t tile) const;
+    bool is_zero(const state& planes, const rect& rect) const;
+    void rebuild_activity(std::uint32_t edge);
+    void dilate_activity();
+    void clear_tile(std::uint32_t tile);
+    void mark_generator();
+
+  public:
+    // Same result as GLSL clamp on a NaN input for common drivers, then the render target
+    // store, rounding to nearest even like the conversions in hardware
+    inline static std::float_t encode(std::float_t v, storage storage)
+    {
+      v = std::fmin(std::fmax(v, 0.0f), 1.0f);
+
+      switch (storage)
+      {
+        case e_storage_unorm8:
+        {
+          return std::nearbyint(v * 255.0f) / 255.0f;
+        }
+        case e_storage_half:
+        {
+          // Below 2^-14 half is subnormal with a fixed step of 2^-24
+          if (v < 6.103515625e-5f) return std::nearbyint(v * 16777216.0f) / 16777216.0f;
+
+          std::uint32_t u{ std::bit_cast<std::uint32_t>(v) };
+
+          return std::bit_cast<std::float_t>((u + 0xFFFu + ((u >> 13) & 1u)) & ~0x1FFFu);
+        }
+        case e_storage_bfloat:
+        {
+          std::uint32_t u{ std::bit_cast<std::uint32_t>(v) };
+
+          return std::bit_cast<std::float_t>((u + 0x7FFFu + ((u >> 16) & 1u)) & ~0xFFFFu);
+        }
+        case e_storage_float:
+        {
+          return v;
+        }
+      }
+
+      return v;
+    }
+
+    // Bit patterns of the 16 bit formats, narrow encodes first
+    inline static std::uint16_t narrow(std::float_t v, storage storage)
+    {
+      std::uint32_t u{ std::bit_cast<std::uint32_t>(encode(v, storage)) };
+
+      if (storage == e_storage_bfloat) return static_cast<std::uint16_t>(u >> 16);
+
+      // Subnormal halves count in steps of 2^-24, 2^-14 itself lands on the first normal
+      if (std::bit_cast<std::float_t>(u) < 6.103515625e-5f) return static_cast<std::uint16_t>(std::bit_cast<std::float_t>(u) * 16777216.0f);
+
+      return static_cast<std::uint16_t>((u - (112u << 23)) >> 13);
+    }
+
+    inline static std::float_t widen(std::uint16_t bits, storage storage)
+    {
+      if (storage == e_storage_bfloat) return std::bit_cast<std::float_t>(static_cast<std::uint32_t>(bits) << 16);
+
+      if (bits < 0x400u) return static_cast<std::float_t>(bits) / 16777216.0f;
+
+      return std::bit_cast<std::float_t>((static_cast<std::uint32_t>(bits) << 13) + (112u << 23));
+    }
+
+    inline static bool is_narrow(storage storage) { return storage == e_storage_half || storage == e_storage_bfloat; }
+
+  private:
+    inline std::float_t store(std::float_t v) const { return encode(v, m_storage); }
+
+    inline std::float_t load(const state& planes, std::uint32_t i) const { return planes.bits.empty() ? planes.values[i] : widen(planes.bits[i], m_storage); }
+    inline void save(state& planes, std::uint32_t i, std::float_t v) const
+    {
+      if (planes.bits.empty()) planes.values[i] = store(v);
+      else planes.bits[i] = narrow(v, m_storage);
+    }
+
+    inline std::float_t grow(const kernel& kernel, std::float_t sum) const
+    {
+      const growth& growth{ kernel.growth };
+
+      return m_growth_table ? system::bump_table(sum, growth.height, growth.offset, growth.smoothness, growth.sharpness) : system::bump(sum, growth.height, growth.offset, growth.smoothness, growth.sharpness);
+    }
+
+    // State and generator both hold three equal planes
+    inline std::float_t* get_plane(std::vector<std::float_t>& planes, std::uint32_t channel) { return &planes[channel * (planes.size() / 3)]; }
+    inline const std::float_t* get_plane(const std::vector<std::float_t>& planes, std::uint32_t channel) const { return &planes[channel * (planes.size() / 3)]; }
+
+  private:
+    std::uint32_t m_system_width{};
+    std::uint32_t m_system_height{};
+
+    std::uint32_t m_generator_width{};
+    std::uint32_t m_generator_height{};
+
+    std::vector<slot> m_slots{};
+
+    state m_front{};
+    state m_back{};
+    std::vector<std::float_t> m_generator{};
+
+    std::uint32_t m_halo{};
+    std::vector<std::uint32_t> m_wrap_x{};
+    std::vector<std::uint32_t> m_wrap_y{};
+
+    convolution m_convolution{ e_conv_direct };
+    simd::isa m_isa{ simd::detect() };
+    storage m_storage{ e_storage_unorm8 };
+    bool m_lowrank{};
+    bool m_sparse{};
+    bool m_tiling{ true };
+    std::uint32_t m_tile{};
+    std::uint32_t m_temporal{ 1 };
+    bool m_growth_table{};
+
+    bool m_skipping{ true };
+    std::uint32_t m_active_tiles{};
+    std::uint32_t m_tile_count{};
+    std::uint32_t m_activity_edge{};
+    std::vector<std::uint8_t> m_front_active{};
+    std::vector<std::uint8_t> m_next_active{};
+    std::vector<std::uint8_t> m_front_clear{};
+    std::vector<std::uint8_t> m_back_clear{};
+    std::vector<std::uint8_t> m_needed{};
+    std::vector<std::uint32_t> m_near_x{};
+    std::vector<std::uint32_t> m_near_y{};
+    std::uint32_t m_radius{};
+    std::uint32_t m_l2_size{ simd::detect_l2_size() };
+    std::uint32_t m_padded_width{};
+    std::array<std::vector<std::float_t>, 3> m_padded{};
+
+    std::unique_ptr<fft> m_fft{};
+    std::array<std::vector<fft::value>, 3> m_spectra{};
+
+    thread_pool m_pool;
+    std::vector<scratch> m_scratch{};
+
+    std::uint64_t m_cells{};
+    std::double_t m_seconds{};
+  };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include <numbers>
+
+#include <fft.h>
+
+namespace we
+{
+  fft::fft(std::uint32_t width, std::uint32_t height)
+    : m_width{ width }
+    , m_height{ height }
+  {
+    build(m_width, m_reverse_x, m_twiddles_x);
+    build(m_height, m_reverse_y, m_twiddles_y);
+  }
+
+  void fft::forward(std::vector<value>& values) const
+  {
+    transform(values, false);
+  }
+
+  void fft::inverse(std::vector<value>& values) const
+  {
+    transform(values, true);
+
+    std::double_t scale{ 1.0 / (static_cast<std::double_t>(m_width) * m_height) };
+
+    for (value& v : values)
+    {
+      v *= scale;
+    }
+  }
+
+  void fft::transform(std::vector<value>& values, bool inverse) const
+  {
+    for (std::uint32_t j{}; j < m_height; j++)
+    {
+      transform_1d(&values[j * m_width], m_width, 1, m_reverse_x, m_twiddles_x, inverse);
+    }
+
+    for (std::uint32_t i{}; i < m_width; i++)
+    {
+      transform_1d(&values[i], m_height, m_width, m_reverse_y, m_twiddles_y, inverse);
+    }
+  }
+
+  void fft::transform_1d(value* values, std::uint32_t count, std::uint32_t stride, const std::vector<std::uint32_t>& reverse, const std::vector<value>& twiddles, bool inverse) const
+  {
+    for (std::uint32_t i{}; i < count; i++)
+    {
+      if (i < reverse[i]) std::swap(values[i * stride], values[reverse[i] * stride]);
+    }
+
+    for (std::uint32_t length{ 2 }; length <= count; length <<= 1)
+    {
+      std::uint32_t half{ length / 2 };
+      std::uint32_t step{ count / length };
+
+      for (std::uint32_t i{}; i < count; i += length)
+      {
+        for (std::uint32_t k{}; k < half; k++)
+        {
+          value w{ inverse ? std::conj(twiddles[k * step]) : twiddles[k * step] };
+          value& a{ values[(i + k) * stride] };
+          value& b{ values[(i + k + half) * stride] };
+          value t{ b * w };
+
+          b = a - t;
+          a = a + t;
+        }
+      }
+    }
+  }
+
+  void fft::build(std::uint32_t count, std::vector<std::uint32_t>& reverse, std::vector<value>& twiddles)
+  {
+    std::uint32_t bits{};
+    while ((1u << bits) < count) bits++;
+
+    reverse.resize(count);
+    twiddles.resize(count / 2 + 1);
+
+    for (std::uint32_t i{}; i < count; i++)
+    {
+      std::uint32_t r{};
+      for (std::uint32_t b{}; b < bits; b++)
+      {
+        if (i & (1u << b)) r |= 1u << (bits - 1 - b);
+      }
+
+      reverse[i] = r;
+    }
+
+    for (std::uint32_t k{}; k < twiddles.size(); k++)
+    {
+      std::double_t angle{ -2.0 * std::numbers::pi * k / count };
+
+      twiddles[k] = value{ std::cos(angle), std::sin(angle) };
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef WE_FFT_H
+#define WE_FFT_H
+
+#include <cstdint>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+namespace we
+{
+  // Radix-2 2D transform for power of two sizes, precomputed per world size
+  class fft
+  {
+  public:
+    using value = std::complex<std::double_t>;
+
+  public:
+    fft(std::uint32_t width, std::uint32_t height);
+
+  public:
+    inline static bool is_supported(std::uint32_t width, std::uint32_t height) { return width && height && !(width & (width - 1)) && !(height & (height - 1)); }
+
+  public:
+    void forward(std::vector<value>& values) const;
+    void inverse(std::vector<value>& values) const;
+
+  private:
+    void transform(std::vector<value>& values, bool inverse) const;
+    void transform_1d(value* values, std::uint32_t count, std::uint32_t stride, const std::vector<std::uint32_t>& reverse, const std::vector<value>& twiddles, bool inverse) const;
+
+  private:
+    static void build(std::uint32_t count, std::vector<std::uint32_t>& reverse, std::vector<value>& twiddles);
+
+  private:
+    std::uint32_t m_width{};
+    std::uint32_t m_height{};
+
+    std::vector<std::uint32_t> m_reverse_x{};
+    std::vector<std::uint32_t> m_reverse_y{};
+
+    std::vector<value> m_twiddles_x{};
+    std::vector<value> m_twiddles_y{};
+  };
+}
+
+#endif
\ No newline at end of file
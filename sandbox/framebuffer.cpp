@@ -8,7 +8,7 @@ namespace we
 {
   void framebuffer::create(std::uint32_t& fbo, std::uint32_t attachment0)
   {
-    glGenFramebuffers(3, &fbo);
+    glGenFramebuffers(1, &fbo);
 
     glBindFramebuffer(GL_FRAMEBUFFER, fbo);
 
@@ -19,4 +19,24 @@ namespace we
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
   }
+
+  void framebuffer::create_layered(std::uint32_t& fbo, std::uint32_t attachment0)
+  {
+    glGenFramebuffers(1, &fbo);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+    // Every layer is attached, gl_Layer picks the one written
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, attachment0, 0);
+
+    std::array<std::uint32_t, 1> attachments{ GL_COLOR_ATTACHMENT0 };
+    glDrawBuffers(1, &attachments[0]);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  void framebuffer::destroy(std::uint32_t fbo)
+  {
+    glDeleteFramebuffers(1, &fbo);
+  }
 }
\ No newline at end of file
@@ -12,6 +12,9 @@ namespace we
 
   public:
     static void create(std::uint32_t& fbo, std::uint32_t attachment0);
+    static void create_layered(std::uint32_t& fbo, std::uint32_t attachment0);
+
+    static void destroy(std::uint32_t fbo);
   };
 }
 
@@ -0,0 +1,407 @@
+#include <cstdio>
+#include <memory>
+#include <algorithm>
+
+#include <grid.h>
+#include <engine.h>
+#include <texture.h>
+#include <shader.h>
+#include <framebuffer.h>
+#include <vao.h>
+#include <buffer.h>
+#include <growth_table.h>
+
+#include <glad/glad.h>
+
+namespace we
+{
+  grid::grid(std::uint32_t system_width, std::uint32_t system_height, std::uint32_t generator_width, std::uint32_t generator_height, std::uint32_t layer_count, const std::unordered_multimap<std::uint32_t, kernel>& kernels, texture::format storage)
+    : m_system_width{ system_width }
+    , m_system_height{ system_height }
+    , m_generator_width{ generator_width }
+    , m_generator_height{ generator_height }
+    , m_layer_count{ layer_count }
+    , m_storage{ storage }
+  {
+    // Kernel order of the program, the same one system::rebuild_shader uses
+    auto range0{ kernels.equal_range(0) };
+    auto range1{ kernels.equal_range(1) };
+    auto range2{ kernels.equal_range(2) };
+
+    for (auto it{ range0.first }; it != range0.second; it++) { m_indices[it->second.name] = static_cast<std::uint32_t>(m_names.size()); m_names.emplace_back(it->second.name); m_channels.emplace_back(it->second.channel); }
+    for (auto it{ range1.first }; it != range1.second; it++) { m_indices[it->second.name] = static_cast<std::uint32_t>(m_names.size()); m_names.emplace_back(it->second.name); m_channels.emplace_back(it->second.channel); }
+    for (auto it{ range2.first }; it != range2.second; it++) { m_indices[it->second.name] = static_cast<std::uint32_t>(m_names.size()); m_names.emplace_back(it->second.name); m_channels.emplace_back(it->second.channel); }
+
+    m_kernels.resize(m_layer_count, kernels);
+    m_growth_tables.resize(m_layer_count);
+
+    // Create textures
+    texture::create_random_rgb_array(m_textures[e_tex_front], m_system_width, m_system_height, m_layer_count, 0.0f, 1.0f, m_storage);
+    texture::create_fill_array(m_textures[e_tex_back], m_system_width, m_system_height, m_layer_count, 0.0f, m_storage);
+    texture::create_random_rgb_array(m_textures[e_tex_gen], m_generator_width, m_generator_height, m_layer_count, 0.0f, 1.0f);
+
+    // Create framebuffers
+    framebuffer::create_layered(m_fbos[e_fb_front], m_textures[e_tex_front]);
+    framebuffer::create_layered(m_fbos[e_fb_back], m_textures[e_tex_back]);
+
+    // Create vaos
+    vao::create(m_vaos[e_vao_rect], 4, &vao::s_rect_vertices[0], 6, &vao::s_rect_elements[0]);
+
+    // Build initial state
+    shader::create(m_programs[e_prog_tile], shader::s_tile_vertex_source, shader::s_tile_fragment_source);
+
+    rebuild_buffers();
+    rebuild_shader();
+  }
+
+  void grid::set_kernels(std::uint32_t layer, const std::unordered_multimap<std::uint32_t, kernel>& kernels)
+  {
+    m_kernels[layer] = kernels;
+
+    m_dirty = 1;
+  }
+
+  void grid::set_growth_table(std::uint32_t layer, bool growth_table)
+  {
+    if (m_growth_tables[layer] == growth_table) return;
+
+    m_growth_tables[layer] = growth_table;
+
+    m_dirty = 1;
+  }
+
+  void grid::load_layer(std::uint32_t layer, std::uint32_t front, std::uint32_t generator)
+  {
+    std::vector<std::float_t> state{};
+    std::vector<std::float_t> seed{};
+
+    state.resize(m_system_width * m_system_height * 4);
+    seed.resize(m_generator_width * m_generator_height * 4);
+
+    glGetTextureImage(front, 0, GL_RGBA, GL_FLOAT, static_cast<std::int32_t>(state.size() * sizeof(std::float_t)), &state[0]);
+    glGetTextureImage(generator, 0, GL_RGBA, GL_FLOAT, static_cast<std::int32_t>(seed.size() * sizeof(std::float_t)), &seed[0]);
+
+    glTextureSubImage3D(m_textures[e_tex_front], 0, 0, 0, layer, m_system_width, m_system_height, 1, GL_RGBA, GL_FLOAT, &state[0]);
+    glTextureSubImage3D(m_textures[e_tex_gen], 0, 0, 0, layer, m_generator_width, m_generator_height, 1, GL_RGBA, GL_FLOAT, &seed[0]);
+  }
+
+  void grid::store_layer(std::uint32_t layer, std::uint32_t front) const
+  {
+    std::vector<std::float_t> state{};
+
+    state.resize(m_system_width * m_system_height * 4);
+
+    glGetTextureSubImage(m_textures[e_tex_front], 0, 0, 0, layer, m_system_width, m_system_height, 1, GL_RGBA, GL_FLOAT, static_cast<std::int32_t>(state.size() * sizeof(std::float_t)), &state[0]);
+    glTextureSubImage2D(front, 0, 0, 0, m_system_width, m_system_height, GL_RGBA, GL_FLOAT, &state[0]);
+  }
+
+  void grid::update()
+  {
+    if (m_dirty)
+    {
+      m_dirty = 0;
+
+      rebuild_buffers();
+    }
+  }
+
+  void grid::swap()
+  {
+    // Set viewport to system size
+    glViewport(0, 0, m_system_width, m_system_height);
+
+    // Compute next state of every layer, the rect covers every texel so the target is not cleared
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbos[e_fb_back]);
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_textures[e_tex_gen]);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_textures[e_tex_front]);
+
+    glUseProgram(m_programs[e_prog_step]);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_buffers[e_buf_weights]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_buffers[e_buf_params]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_buffers[e_buf_footprints]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, system::get_growth_buffer());
+
+    glBindVertexArray(m_vaos[e_vao_rect]);
+    glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr, m_layer_count);
+    glBindVertexArray(0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // Back becomes front by swapping handles
+    std::swap(m_textures[e_tex_front], m_textures[e_tex_back]);
+    std::swap(m_fbos[e_fb_front], m_fbos[e_fb_back]);
+  }
+
+  void grid::draw(std::uint32_t columns)
+  {
+    std::uint32_t rows{ (m_layer_count + columns - 1) / columns };
+
+    // Every layer as one tile of the current viewport
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_textures[e_tex_front]);
+
+    glUseProgram(m_programs[e_prog_tile]);
+
+    glUniform1i(0, columns);
+    glUniform1i(1, rows);
+
+    glBindVertexArray(m_vaos[e_vao_rect]);
+    glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr, m_layer_count);
+    glBindVertexArray(0);
+  }
+
+  void grid::verify()
+  {
+    static const std::array<std::uint32_t, 3> s_channels{ GL_RED, GL_GREEN, GL_BLUE };
+
+    std::uint32_t cells{ m_system_width * m_system_height };
+    std::uint32_t generator_cells{ m_generator_width * m_generator_height };
+
+    std::vector<std::float_t> layers{};
+    std::vector<std::float_t> generators{};
+    std::vector<std::float_t> state{};
+    std::vector<std::float_t> generator{};
+
+    layers.resize(cells * m_layer_count * 3);
+    generators.resize(generator_cells * m_layer_count * 4);
+    state.resize(cells * 3);
+
+    // One channel of every layer at a time, layer after layer
+    for (std::uint32_t c{}; c < 3; c++) glGetTextureImage(m_textures[e_tex_front], 0, s_channels[c], GL_FLOAT, static_cast<std::int32_t>(cells * m_layer_count * sizeof(std::float_t)), &layers[c * cells * m_layer_count]);
+    glGetTextureImage(m_textures[e_tex_gen], 0, GL_RGBA, GL_FLOAT, static_cast<std::int32_t>(generators.size() * sizeof(std::float_t)), &generators[0]);
+
+    std::vector<std::unique_ptr<engine>> engines{};
+
+    for (std::uint32_t layer{}; layer < m_layer_count; layer++)
+    {
+      engine& engine{ *engines.emplace_back(std::make_unique<we::engine>(m_system_width, m_system_height, m_generator_width, m_generator_height, 1)) };
+
+      for (std::uint32_t c{}; c < 3; c++) std::copy_n(&layers[(c * m_layer_count + layer) * cells], cells, &state[c * cells]);
+
+      generator.assign(generators.begin() + layer * generator_cells * 4, generators.begin() + (layer + 1) * generator_cells * 4);
+
+      engine.set_kernels(m_kernels[layer]);
+      engine.set_growth_table(m_growth_tables[layer]);
+      engine.set_storage((m_storage == texture::e_format_half) ? engine::e_storage_half : (m_storage == texture::e_format_float) ? engine::e_storage_float : engine::e_storage_unorm8);
+      engine.set_planes(state);
+      engine.set_generator(generator);
+      engine.step();
+    }
+
+    swap();
+
+    for (std::uint32_t c{}; c < 3; c++) glGetTextureImage(m_textures[e_tex_front], 0, s_channels[c], GL_FLOAT, static_cast<std::int32_t>(cells * m_layer_count * sizeof(std::float_t)), &layers[c * cells * m_layer_count]);
+
+    std::float_t error{};
+    std::uint32_t mismatches{};
+    std::vector<std::float_t> values{};
+
+    for (std::uint32_t layer{}; layer < m_layer_count; layer++)
+    {
+      engines[layer]->get_planes(values);
+
+      for (std::uint32_t c{}; c < 3; c++)
+      {
+        for (std::uint32_t i{}; i < cells; i++)
+        {
+          std::float_t e{ std::fabs(values[c * cells + i] - layers[(c * m_layer_count + layer) * cells + i]) };
+
+          if (!(e <= engine::s_tolerance)) mismatches++;
+          if (e > error) error = e;
+        }
+      }
+    }
+
+    std::printf("Verify %u layers, max error %.7f, %u of %zu values above tolerance\n", m_layer_count, error, mismatches, layers.size());
+  }
+
+  void grid::rebuild_buffers()
+  {
+    std::vector<std::float_t> weights{};
+    std::vector<param> params{};
+    std::vector<std::int32_t> footprints{};
+
+    params.resize(m_layer_count * m_names.size());
+    footprints.resize(m_layer_count * 2);
+
+    for (std::uint32_t layer{}; layer < m_layer_count; layer++)
+    {
+      // Union footprint of the fused loop, a kernel of size k covers [-k / 2, k - k / 2)
+      std::uint32_t before{};
+      std::uint32_t after{};
+
+      for (const auto& [channel, kernel] : m_kernels[layer])
+      {
+        param& param{ params[layer * m_names.size() + m_indices.at(kernel.name)] };
+
+        param.time = kernel.time;
+        param.growth_height = kernel.growth.height;
+        param.growth_offset = kernel.growth.offset;
+        param.growth_smoothness = kernel.growth.smoothness;
+        param.growth_sharpness = static_cast<std::int32_t>(kernel.growth.sharpness);
+        param.size = static_cast<std::int32_t>(kernel.size);
+        param.offset = static_cast<std::int32_t>(weights.size());
+        param.growth_table = m_growth_tables[layer];
+
+        weights.insert(weights.end(), kernel.values.begin(), kernel.values.end());
+
+        before = std::max(before, kernel.size / 2);
+        after = std::max(after, kernel.size - kernel.size / 2);
+      }
+
+      footprints[layer * 2 + 0] = static_cast<std::int32_t>(before);
+      footprints[layer * 2 + 1] = static_cast<std::int32_t>(before + after);
+    }
+
+    if (m_buffers[e_buf_weights])
+    {
+      buffer::update_storage(m_buffers[e_buf_weights], weights);
+      buffer::update_storage(m_buffers[e_buf_params], &params[0], params.size() * sizeof(param));
+      buffer::update_storage(m_buffers[e_buf_footprints], &footprints[0], footprints.size() * sizeof(std::int32_t));
+    }
+    else
+    {
+      buffer::create_storage(m_buffers[e_buf_weights], weights);
+      buffer::create_storage(m_buffers[e_buf_params], &params[0], params.size() * sizeof(param));
+      buffer::create_storage(m_buffers[e_buf_footprints], &footprints[0], footprints.size() * sizeof(std::int32_t));
+    }
+  }
+
+  void grid::rebuild_shader()
+  {
+    std::uint32_t count{ static_cast<std::uint32_t>(m_names.size()) };
+
+    std::stringstream shader{};
+
+    shader << "#version 460 core\n\n";
+    shader << "layout (location = 0) in Forward\n{\n  vec4 uv;\n} i_fwd;\n\n";
+    shader << "layout (location = 1) flat in int i_layer;\n\n";
+    shader << "layout (location = 0) out vec4 o_color;\n\n";
+    shader << "layout (binding = 0) uniform sampler2DArray u_texture;\n";
+    shader << "layout (binding = 1) uniform sampler2DArray u_generators;\n\n";
+
+    shader << "struct Param\n{\n";
+    shader << "  float time;\n";
+    shader << "  float growth_height;\n";
+    shader << "  float growth_offset;\n";
+    shader << "  float growth_smoothness;\n";
+    shader << "  int growth_sharpness;\n";
+    shader << "  int size;\n";
+    shader << "  int offset;\n";
+    shader << "  int growth_table;\n";
+    shader << "};\n\n";
+
+    // Dense weights of every layer back to back, placed by Param.offset
+    shader << "layout (std430, binding = 0) readonly buffer Weights\n{\n  float u_weights[];\n};\n\n";
+    shader << "layout (std430, binding = 1) readonly buffer Params\n{\n  Param u_params[];\n};\n\n";
+    shader << "layout (std430, binding = 2) readonly buffer Footprints\n{\n  ivec2 u_footprints[];\n};\n\n";
+    shader << "layout (std430, binding = 3) readonly buffer Growth\n{\n  float u_growth[];\n};\n\n";
+
+    shader << "const vec2 c_texture_size = vec2(" << m_system_width << ", " << m_system_height << ");\n";
+    shader << "const ivec2 c_generator_origin = ivec2(" << m_system_width / 2 << ", " << m_system_height / 2 << ");\n";
+    shader << "const ivec2 c_generator_size = ivec2(" << m_generator_width << ", " << m_generator_height << ");\n";
+    shader << "const int c_growth_size = " << growth_table::get_size() << ";\n";
+    shader << "const int c_growth_max_sharpness = " << growth_table::s_max_sharpness << ";\n\n";
+
+    // Same power by squaring as system::stringify_growth_shape
+    shader << "float growth_power(float x, int n)\n{\n";
+    shader << "  float v = 1.0;\n\n";
+    shader << "  for (; n > 0; n >>= 1)\n  {\n";
+    shader << "    if ((n & 1) != 0) v *= x;\n\n";
+    shader << "    x *= x;\n";
+    shader << "  }\n\n";
+    shader << "  return v;\n";
+    shader << "}\n\n";
+
+    // Same lookup as system::stringify_growth_shape, taken by layers that use the table
+    shader << "float growth_table(float t, int n)\n{\n";
+    shader << "  if (n > c_growth_max_sharpness) return 1.0 / (1.0 + growth_power(t, n));\n\n";
+    shader << "  float p = clamp((1.0 - 1.0 / (1.0 + t)) * float(c_growth_size - 1), 0.0, float(c_growth_size - 1));\n";
+    shader << "  int i = min(int(p), c_growth_size - 2);\n";
+    shader << "  int row = n * c_growth_size + i;\n\n";
+    shader << "  return mix(u_growth[row], u_growth[row + 1], p - float(i));\n";
+    shader << "}\n\n";
+
+    shader << "float growth(Param p, float x)\n{\n";
+    shader << "  float t = abs((x - p.growth_offset) / p.growth_smoothness);\n\n";
+    shader << "  if (p.growth_table != 0) return p.growth_height * growth_table(t, p.growth_sharpness) - 1.0;\n\n";
+    shader << "  return (p.growth_height / (1.0 + growth_power(t, p.growth_sharpness))) - 1.0;\n";
+    shader << "}\n\n";
+
+    shader << "void main()\n{\n";
+
+    // Cells under the generator are overwritten anyway
+    shader << "  ivec2 g = ivec2(gl_FragCoord.xy) - c_generator_origin;\n\n";
+    shader << "  if (all(greaterThanEqual(g, ivec2(0))) && all(lessThan(g, c_generator_size)))\n  {\n";
+    shader << "    o_color = vec4(texelFetch(u_generators, ivec3(g, i_layer), 0).rgb, 1.0);\n";
+    shader << "    return;\n";
+    shader << "  }\n\n";
+
+    shader << "  float fx = 1.0 / c_texture_size.x;\n";
+    shader << "  float fy = 1.0 / c_texture_size.y;\n";
+    shader << "  float layer = float(i_layer);\n\n";
+    shader << "  int before = u_footprints[i_layer].x;\n";
+    shader << "  int size = u_footprints[i_layer].y;\n\n";
+
+    for (std::uint32_t k{}; k < count; k++)
+    {
+      shader << "  Param " << m_names[k] << "_p = u_params[i_layer * " << count << " + " << k << "];\n";
+      shader << "  int " << m_names[k] << "_o = before - " << m_names[k] << "_p.size / 2;\n";
+      shader << "  float " << m_names[k] << "_sum = 0.0;\n";
+    }
+
+    shader << "\n";
+
+    // Same fetches and summation order as system::stringify_fused_convolution
+    shader << "  for (int i = 0; i < size; i++)\n  {\n";
+    shader << "    for (int j = 0; j < size; j++)\n    {\n";
+    shader << "      vec3 s = texture(u_texture, vec3(i_fwd.uv.xy + vec2(fx * float(i - before), fy * float(j - before)), layer)).rgb;\n\n";
+
+    for (std::uint32_t k{}; k < count; k++)
+    {
+      std::string o{ m_names[k] + "_o" };
+      std::string n{ m_names[k] + "_p.size" };
+
+      shader << "      if (uint(i - " << o << ") < uint(" << n << ") && uint(j - " << o << ") < uint(" << n << ")) ";
+      shader << m_names[k] << "_sum += u_weights[" << m_names[k] << "_p.offset + (i - " << o << ") + (j - " << o << ") * " << n << "] * s." << "rgb"[m_channels[k]] << ";\n";
+    }
+
+    shader << "    }\n";
+    shader << "  }\n\n";
+
+    shader << "  vec3 c = texture(u_texture, vec3(i_fwd.uv.xy, layer)).rgb;\n\n";
+
+    for (std::uint32_t k{}; k < count; k++)
+    {
+      shader << "  float " << m_names[k] << "_g = growth(" << m_names[k] << "_p, " << m_names[k] << "_sum);\n";
+      shader << "  float " << m_names[k] << "_avg = " << m_names[k] << "_sum / float(" << m_names[k] << "_p.size * " << m_names[k] << "_p.size);\n";
+      shader << "  float " << m_names[k] << "_c = " << m_names[k] << "_p.time * " << m_names[k] << "_avg / " << m_names[k] << "_g;\n\n";
+    }
+
+    // Same targets as engine::set_kernels, in the channel order of system::rebuild_shader
+    for (std::uint32_t t{}; t < 3; t++)
+    {
+      shader << "  float " << "rgb"[t] << "m = c." << "rgb"[t];
+
+      for (std::uint32_t k{}; k < count; k++)
+      {
+        std::uint32_t index{ static_cast<std::uint32_t>(m_names[k].back() - '0') };
+
+        if ((index + 3 - m_channels[k] % 3) % 3 == t) shader << " + " << m_names[k] << "_c";
+      }
+
+      shader << ";\n";
+    }
+
+    shader << "\n";
+    shader << "  o_color = vec4(clamp(rm, 0.0, 1.0), clamp(gm, 0.0, 1.0), clamp(bm, 0.0, 1.0), 1.0);\n";
+    shader << "}";
+
+    shader::create(m_programs[e_prog_step], shader::s_layer_vertex_source, shader::s_layer_geometry_source, shader.str());
+  }
+}
\ No newline at end of file
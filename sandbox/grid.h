@@ -0,0 +1,124 @@
+#ifndef WE_GRID_H
+#define WE_GRID_H
+
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <sstream>
+#include <array>
+#include <vector>
+#include <unordered_map>
+
+#include <system.h>
+#include <texture.h>
+
+namespace we
+{
+  // GPU counterpart of batch. Every system of the same size is one layer of a texture array
+  // and the whole grid steps in a single instanced draw, the geometry stage routing each
+  // instance to its layer. Dense weights of all layers sit back to back in one storage
+  // buffer, per kernel parameters and the fused footprint of each layer in two more, so
+  // the GL calls per step and per draw do not grow with the layer count.
+  //
+  // The program is generated once from the names and channels of the kernels given to the
+  // constructor, and set_kernels expects the same set per layer. Only the fused dense
+  // convolution is generated, low rank and sparse are not. set_growth_table picks the
+  // growth of system::bump_table per layer. Cells under the generator take
+  // the generator value in the same draw instead of being blitted over afterwards.
+  class grid
+  {
+  public:
+    enum texture_idx
+    {
+      e_tex_front,
+      e_tex_back,
+      e_tex_gen,
+    };
+    enum framebuffer_idx
+    {
+      e_fb_front,
+      e_fb_back,
+    };
+    enum vao_idx
+    {
+      e_vao_rect,
+    };
+    enum buffer_idx
+    {
+      e_buf_weights,
+      e_buf_params,
+      e_buf_footprints,
+    };
+    enum shader_idx
+    {
+      e_prog_step,
+      e_prog_tile,
+    };
+
+  public:
+    grid(std::uint32_t system_width, std::uint32_t system_height, std::uint32_t generator_width, std::uint32_t generator_height, std::uint32_t layer_count, const std::unordered_multimap<std::uint32_t, kernel>& kernels, texture::format storage = texture::e_format_unorm8);
+
+  public:
+    inline std::uint32_t get_layer_count() const { return m_layer_count; }
+
+  public:
+    void set_kernels(std::uint32_t layer, const std::unordered_multimap<std::uint32_t, kernel>& kernels);
+    void set_growth_table(std::uint32_t layer, bool growth_table);
+
+    // Copies a world between a layer and a system's textures, converting between storage formats
+    void load_layer(std::uint32_t layer, std::uint32_t front, std::uint32_t generator);
+    void store_layer(std::uint32_t layer, std::uint32_t front) const;
+
+  public:
+    void update();
+    void swap();
+    void draw(std::uint32_t columns);
+    void verify();
+
+  private:
+    // Same layout as Param in the generated program, 32 bytes under std430
+    struct param
+    {
+      std::float_t time{};
+      std::float_t growth_height{};
+      std::float_t growth_offset{};
+      std::float_t growth_smoothness{};
+      std::int32_t growth_sharpness{};
+      std::int32_t size{};
+      std::int32_t offset{};
+      std::int32_t growth_table{};
+    };
+
+  private:
+    void rebuild_buffers();
+    void rebuild_shader();
+
+  private:
+    std::uint32_t m_system_width{};
+    std::uint32_t m_system_height{};
+
+    std::uint32_t m_generator_width{};
+    std::uint32_t m_generator_height{};
+
+    std::uint32_t m_layer_count{};
+
+    std::vector<std::string> m_names{};
+    std::vector<std::uint32_t> m_channels{};
+    std::unordered_map<std::string, std::uint32_t> m_indices{};
+
+    std::vector<std::unordered_multimap<std::uint32_t, kernel>> m_kernels{};
+    std::vector<std::uint8_t> m_growth_tables{};
+
+    std::array<std::uint32_t, 3> m_textures{};
+    std::array<std::uint32_t, 2> m_fbos{};
+    std::array<std::uint32_t, 1> m_vaos{};
+    std::array<std::uint32_t, 3> m_buffers{};
+    std::array<std::uint32_t, 2> m_programs{};
+
+    texture::format m_storage{};
+
+    std::uint32_t m_dirty{};
+  };
+}
+
+#endif
\ No newline at end of file
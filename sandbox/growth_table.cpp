@@ -0,0 +1,103 @@
+#include <algorithm>
+
+#include <growth_table.h>
+
+namespace we
+{
+  static std::double_t evaluate(std::double_t u, std::uint32_t sharpness)
+  {
+    // u = 1 is t = inf, where the shape is 0 except for the constant 1 / 2 of n = 0
+    if (u >= 1.0) return sharpness ? 0.0 : 0.5;
+
+    std::double_t t{ u / (1.0 - u) };
+    std::double_t v{ 1.0 };
+
+    for (std::uint32_t n{ sharpness }; n; n >>= 1)
+    {
+      if (n & 1) v *= t;
+
+      t *= t;
+    }
+
+    return 1.0 / (1.0 + v);
+  }
+
+  std::float_t growth_table::sample(std::float_t t, std::uint32_t sharpness)
+  {
+    if (sharpness > s_max_sharpness) return 1.0f / (1.0f + power(t, sharpness));
+
+    const table& table{ get_table() };
+
+    // Same steps as the generated growth_table in GLSL, t = inf lands on u = 1
+    std::float_t last{ static_cast<std::float_t>(table.size - 1) };
+    std::float_t p{ std::min(std::max(0.0f, (1.0f - 1.0f / (1.0f + t)) * last), last) };
+    std::uint32_t i{ std::min(static_cast<std::uint32_t>(p), table.size - 2) };
+    const std::float_t* row{ &table.values[sharpness * table.size + i] };
+
+    return row[0] + (row[1] - row[0]) * (p - static_cast<std::float_t>(i));
+  }
+
+  const std::vector<std::float_t>& growth_table::get_values()
+  {
+    return get_table().values;
+  }
+
+  std::uint32_t growth_table::get_size()
+  {
+    return get_table().size;
+  }
+
+  std::float_t growth_table::get_error()
+  {
+    return get_table().error;
+  }
+
+  const growth_table::table& growth_table::get_table()
+  {
+    static const table s_table{ build() };
+
+    return s_table;
+  }
+
+  growth_table::table growth_table::build()
+  {
+    static const std::uint32_t s_min_size{ 256 };
+    static const std::uint32_t s_max_size{ 16384 };
+    static const std::uint32_t s_checks{ 8 };
+
+    table table{};
+
+    for (table.size = s_min_size; ; table.size *= 2)
+    {
+      std::double_t step{ 1.0 / (table.size - 1) };
+      std::double_t error{};
+
+      table.values.resize((s_max_sharpness + 1) * table.size);
+
+      for (std::uint32_t n{}; n <= s_max_sharpness; n++)
+      {
+        std::float_t* row{ &table.values[n * table.size] };
+
+        for (std::uint32_t i{}; i < table.size; i++) row[i] = static_cast<std::float_t>(evaluate(i * step, n));
+
+        // Between the samples, where interpolation is furthest off
+        for (std::uint32_t i{}; i + 1 < table.size; i++)
+        {
+          for (std::uint32_t k{ 1 }; k < s_checks; k++)
+          {
+            std::double_t w{ static_cast<std::double_t>(k) / s_checks };
+            std::double_t v{ row[i] + (static_cast<std::double_t>(row[i + 1]) - row[i]) * w };
+
+            error = std::max(error, std::fabs(v - evaluate((i + w) * step, n)));
+          }
+        }
+      }
+
+      table.error = static_cast<std::float_t>(error);
+
+      if (error <= s_max_error || table.size >= s_max_size) break;
+    }
+
+    return table;
+  }
+}
\ No newline at end of file
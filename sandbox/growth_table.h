@@ -0,0 +1,61 @@
+#ifndef WE_GROWTH_TABLE_H
+#define WE_GROWTH_TABLE_H
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+
+namespace we
+{
+  // The growth is height / (1 + t^n) - 1 with t = |x - offset| / smoothness. The table holds
+  // 1 / (1 + t^n) for every sharpness n up to s_max_sharpness, one row of get_size samples
+  // each, spaced evenly over u = t / (1 + t) so the whole half line fits. Rows are doubled
+  // until linear interpolation stays within s_max_error on a dense check, get_error is what
+  // that check measured. The growth then differs by at most height times that.
+  class growth_table
+  {
+  public:
+    inline static const std::uint32_t s_max_sharpness{ 100 };
+    inline static const std::float_t s_max_error{ 1.0e-4f };
+
+  public:
+    growth_table() = delete;
+
+  public:
+    // x^n by repeated squaring, 1 for n = 0 whatever x is
+    inline static std::float_t power(std::float_t x, std::uint32_t n)
+    {
+      std::float_t v{ 1.0f };
+
+      for (; n; n >>= 1)
+      {
+        if (n & 1) v *= x;
+
+        x *= x;
+      }
+
+      return v;
+    }
+
+    // 1 / (1 + t^n), interpolated from the table or computed for a sharpness past it
+    static std::float_t sample(std::float_t t, std::uint32_t sharpness);
+
+    static const std::vector<std::float_t>& get_values();
+    static std::uint32_t get_size();
+    static std::float_t get_error();
+
+  private:
+    struct table
+    {
+      std::vector<std::float_t> values{};
+      std::uint32_t size{};
+      std::float_t error{};
+    };
+
+  private:
+    static const table& get_table();
+    static table build();
+  };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include <vector>
+#include <numeric>
+#include <algorithm>
+
+#include <lowrank.h>
+
+namespace we
+{
+  void lowrank::factor(kernel& kernel, std::float_t max_error)
+  {
+    std::uint32_t n{ kernel.size };
+
+    // One-sided Jacobi on A[j][i] = tap (i, j), rotating columns of A until orthogonal
+    std::vector<std::double_t> a{};
+    std::vector<std::double_t> v{};
+
+    a.resize(n * n);
+    v.resize(n * n);
+
+    for (std::uint32_t i{}; i < n; i++)
+    {
+      for (std::uint32_t j{}; j < n; j++)
+      {
+        a[j * n + i] = kernel.values[i + j * n];
+        v[j * n + i] = (i == j) ? 1.0 : 0.0;
+      }
+    }
+
+    for (std::uint32_t sweep{}; sweep < 32; sweep++)
+    {
+      std::double_t off{};
+
+      for (std::uint32_t p{}; p < n; p++)
+      {
+        for (std::uint32_t q{ p + 1 }; q < n; q++)
+        {
+          std::double_t alpha{};
+          std::double_t beta{};
+          std::double_t gamma{};
+
+          for (std::uint32_t k{}; k < n; k++)
+          {
+            alpha += a[k * n + p] * a[k * n + p];
+            beta += a[k * n + q] * a[k * n + q];
+            gamma += a[k * n + p] * a[k * n + q];
+          }
+
+          if (std::fabs(gamma) <= 1.0e-15 * std::sqrt(alpha * beta)) continue;
+
+          off = std::max(off, std::fabs(gamma) / std::sqrt(alpha * beta));
+
+          std::double_t zeta{ (beta - alpha) / (2.0 * gamma) };
+          std::double_t t{ std::copysign(1.0, zeta) / (std::fabs(zeta) + std::sqrt(1.0 + zeta * zeta)) };
+          std::double_t c{ 1.0 / std::sqrt(1.0 + t * t) };
+          std::double_t s{ c * t };
+
+          for (std::uint32_t k{}; k < n; k++)
+          {
+            std::double_t ap{ a[k * n + p] };
+            std::double_t aq{ a[k * n + q] };
+
+            a[k * n + p] = c * ap - s * aq;
+            a[k * n + q] = s * ap + c * aq;
+
+            std::double_t vp{ v[k * n + p] };
+            std::double_t vq{ v[k * n + q] };
+
+            v[k * n + p] = c * vp - s * vq;
+            v[k * n + q] = s * vp + c * vq;
+          }
+        }
+      }
+
+      if (off < 1.0e-12) break;
+    }
+
+    // Column norms of the rotated matrix are the singular values
+    std::vector<std::double_t> sigma{};
+    std::vector<std::uint32_t> order{};
+
+    sigma.resize(n);
+    order.resize(n);
+
+    std::double_t total{};
+    for (std::uint32_t p{}; p < n; p++)
+    {
+      std::double_t norm{};
+      for (std::uint32_t k{}; k < n; k++) norm += a[k * n + p] * a[k * n + p];
+
+      sigma[p] = std::sqrt(norm);
+      total += norm;
+    }
+
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](std::uint32_t l, std::uint32_t r) { return sigma[l] > sigma[r]; });
+
+    // Pick the smallest rank within the bound
+    std::uint32_t rank{};
+    std::double_t residual{ total };
+
+    while (rank < n && total > 0.0 && std::sqrt(residual / total) > max_error)
+    {
+      residual -= sigma[order[rank]] * sigma[order[rank]];
+      rank++;
+    }
+
+    kernel.rank = rank;
+    kernel.rank_error = (total > 0.0) ? static_cast<std::float_t>(std::sqrt(std::max(residual, 0.0) / total)) : 0.0f;
+    kernel.rows.resize(rank * n);
+    kernel.cols.resize(rank * n);
+
+    for (std::uint32_t r{}; r < rank; r++)
+    {
+      std::uint32_t p{ order[r] };
+      std::double_t s{ sigma[p] };
+
+      for (std::uint32_t k{}; k < n; k++)
+      {
+        kernel.cols[r * n + k] = static_cast<std::float_t>((s > 0.0) ? a[k * n + p] / s : 0.0);
+        kernel.rows[r * n + k] = static_cast<std::float_t>(s * v[k * n + p]);
+      }
+    }
+  }
+}
\ No newline at end of file
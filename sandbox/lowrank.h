@@ -0,0 +1,26 @@
+#ifndef WE_LOWRANK_H
+#define WE_LOWRANK_H
+
+#include <cstdint>
+#include <cmath>
+
+#include <system.h>
+
+namespace we
+{
+  class lowrank
+  {
+  public:
+    lowrank() = delete;
+
+  public:
+    // Splits the kernel into `rank` separable terms, tap (i, j) ~ sum cols[r][j] * rows[r][i],
+    // using the fewest terms whose relative Frobenius residual stays within `max_error`
+    static void factor(kernel& kernel, std::float_t max_error);
+
+    // Separable terms only pay off while 2 * size * rank stays below size * size
+    inline static bool is_worthwhile(const kernel& kernel) { return kernel.rank && (2 * kernel.rank < kernel.size); }
+  };
+}
+
+#endif
\ No newline at end of file
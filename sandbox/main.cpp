@@ -1,11 +1,13 @@
 #include <cstdio>
 #include <string>
 #include <vector>
+#include <array>
 #include <cstdint>
 #include <fstream>
 #include <random>
 #include <format>
 #include <cmath>
+#include <string_view>
 
 #include <glad/glad.h>
 
@@ -16,6 +18,12 @@
 #include <imgui/imgui_impl_opengl3.h>
 
 #include <system.h>
+#include <shader.h>
+#include <engine.h>
+#include <batch.h>
+#include <grid.h>
+#include <benchmark.h>
+#include <allocations.h>
 
 ///////////////////////////////////////////////////////////
 // Locals
@@ -38,6 +46,28 @@ static const std::uint32_t s_system_height{ 256 };
 
 static std::vector<we::system*> s_systems{};
 
+// Steps and draws every system as a layer of one texture array, the systems only hold kernels and UI
+static bool s_grid_enabled{ false };
+static we::grid* s_grid{};
+static std::vector<std::uint32_t> s_grid_revisions{};
+
+static const std::uint32_t s_headless_steps{ 100 };
+static const std::uint32_t s_benchmark_repeats{ 20 };
+static const std::uint32_t s_benchmark_tiling_size{ 1024 };
+static const std::uint32_t s_benchmark_tiling_repeats{ 2 };
+static const std::uint32_t s_benchmark_generation_shapes{ 64 };
+static const std::uint32_t s_benchmark_generation_repeats{ 10 };
+static const std::uint32_t s_drift_steps{ 200 };
+static const std::uint32_t s_drift_interval{ 20 };
+
+static const std::uint32_t s_alloc_check_steps{ 1000 };
+static const std::uint32_t s_alloc_check_width{ 64 };
+static const std::uint32_t s_alloc_check_height{ 64 };
+
+static const std::uint32_t s_batch_worlds{ 256 };
+static const std::uint32_t s_batch_width{ 64 };
+static const std::uint32_t s_batch_height{ 64 };
+
 ///////////////////////////////////////////////////////////
 // Math stuff
 ///////////////////////////////////////////////////////////
@@ -51,6 +81,22 @@ void ui_simulation()
   ImGui::Begin("Simulation Controls");
 
   ImGui::SliderInt("Fps", reinterpret_cast<std::int32_t*>(&s_time_update_fps), 0, 1000);
+  if (ImGui::Checkbox("Texture Array", &s_grid_enabled))
+  {
+    // Carry every world across so toggling keeps stepping the same simulations
+    for (std::uint32_t i{}; i < s_systems.size(); i++)
+    {
+      if (s_grid_enabled)
+      {
+        s_grid->load_layer(i, s_systems[i]->get_front(), s_systems[i]->get_generator());
+      }
+      else
+      {
+        s_grid->store_layer(i, s_systems[i]->get_front());
+      }
+    }
+  }
+  if (s_grid_enabled) ImGui::Text("Fused dense kernels in unorm8 only, per system path and storage options are ignored");
   if (ImGui::Button("Randomize"))
   {
     for (std::uint32_t i{}; i < s_systems.size(); i++)
@@ -59,6 +105,27 @@ void ui_simulation()
     }
   }
 
+  std::uint32_t compiling{};
+  for (std::uint32_t i{}; i < s_systems.size(); i++)
+  {
+    if (s_systems[i]->is_compiling()) compiling++;
+  }
+  ImGui::Text("Compiling %u of %zu systems", compiling, s_systems.size());
+  if (ImGui::Button("Verify CPU"))
+  {
+    if (s_grid_enabled)
+    {
+      s_grid->verify();
+    }
+    else
+    {
+      for (std::uint32_t i{}; i < s_systems.size(); i++)
+      {
+        s_systems[i]->verify();
+      }
+    }
+  }
+
   ImGui::End();
 }
 
@@ -74,12 +141,259 @@ void ui_systems()
   ImGui::End();
 }
 
+///////////////////////////////////////////////////////////
+// Headless
+///////////////////////////////////////////////////////////
+
+void run_headless(std::uint32_t steps, we::engine::convolution convolution, std::uint32_t temporal)
+{
+  std::unordered_multimap<std::uint32_t, we::kernel> kernels{};
+
+  we::system::create_kernels(kernels);
+
+  for (auto& [channel, kernel] : kernels)
+  {
+    we::system::compute_kernel(kernel);
+  }
+
+  std::random_device random{};
+  std::mt19937 generator{ random() };
+  std::uniform_real_distribution<std::float_t> dist{ 0.0f, 1.0f };
+
+  std::vector<std::float_t> state{};
+  std::vector<std::float_t> seed{};
+
+  state.resize(s_system_width * s_system_height * 4);
+  seed.resize(10 * 10 * 4);
+
+  for (std::uint32_t i{}; i < state.size(); i++) state[i] = (i % 4 == 3) ? 1.0f : dist(generator);
+  for (std::uint32_t i{}; i < seed.size(); i++) seed[i] = (i % 4 == 3) ? 1.0f : dist(generator);
+
+  we::engine engine{ s_system_width, s_system_height, 10, 10, 0 };
+
+  engine.set_kernels(kernels);
+  engine.set_state(state);
+  engine.set_generator(seed);
+  engine.set_convolution(convolution);
+  engine.set_temporal(temporal);
+
+  engine.advance(steps);
+
+  std::printf("Stepped %u %s steps of %ux%u, %u per tile pass, on %u threads, %.0f cells/s\n", steps, (engine.get_convolution() == we::engine::e_conv_fft) ? "fft" : "direct", s_system_width, s_system_height, engine.get_temporal(), engine.get_thread_count(), engine.get_cells_per_second());
+  std::printf("Last step ran %u of %u tiles\n", engine.get_active_tiles(), engine.get_tile_count());
+}
+
+// Steps each path once to grow its buffers, then counts allocations across the given steps
+bool run_alloc_check(std::uint32_t steps)
+{
+  std::unordered_multimap<std::uint32_t, we::kernel> kernels{};
+
+  we::system::create_kernels(kernels);
+
+  for (auto& [channel, kernel] : kernels)
+  {
+    we::system::compute_kernel(kernel);
+  }
+
+  std::mt19937 generator{};
+  std::uniform_real_distribution<std::float_t> dist{ 0.0f, 1.0f };
+
+  std::vector<std::float_t> state{};
+  std::vector<std::float_t> seed{};
+
+  state.resize(s_alloc_check_width * s_alloc_check_height * 4);
+  seed.resize(10 * 10 * 4);
+
+  for (std::uint32_t i{}; i < state.size(); i++) state[i] = (i % 4 == 3) ? 1.0f : dist(generator);
+  for (std::uint32_t i{}; i < seed.size(); i++) seed[i] = (i % 4 == 3) ? 1.0f : dist(generator);
+
+  static const std::array<const char*, 6> s_paths{ "tiled", "untiled", "lowrank", "sparse", "temporal", "fft" };
+
+  std::uint64_t failed{};
+
+  for (std::uint32_t path{}; path < s_paths.size(); path++)
+  {
+    we::engine engine{ s_alloc_check_width, s_alloc_check_height, 10, 10, 0 };
+
+    engine.set_kernels(kernels);
+    engine.set_state(state);
+    engine.set_generator(seed);
+    engine.set_tiling(path != 1);
+    engine.set_lowrank(path == 2);
+    engine.set_sparse(path == 3);
+    engine.set_temporal((path == 4) ? 4 : 1);
+    engine.set_convolution((path == 5) ? we::engine::e_conv_fft : we::engine::e_conv_direct);
+    engine.advance(engine.get_temporal());
+
+    we::allocations::start();
+
+    engine.advance(steps);
+
+    we::allocations::stop();
+
+    std::printf("Stepped %s %u times, %llu allocations\n", s_paths[path], steps, static_cast<unsigned long long>(we::allocations::get_count()));
+
+    failed += we::allocations::get_count();
+  }
+
+  we::batch batch{ s_alloc_check_width, s_alloc_check_height, 10, 10, 4, 0 };
+
+  for (std::uint32_t world{}; world < batch.get_world_count(); world++)
+  {
+    batch.set_kernels(world, kernels);
+    batch.set_state(world, state);
+    batch.set_generator(world, seed);
+  }
+
+  batch.step();
+
+  we::allocations::start();
+
+  for (std::uint32_t i{}; i < steps; i++)
+  {
+    batch.step();
+  }
+
+  we::allocations::stop();
+
+  std::printf("Stepped batch %u times, %llu allocations\n", steps, static_cast<unsigned long long>(we::allocations::get_count()));
+
+  failed += we::allocations::get_count();
+
+  return failed == 0;
+}
+
+void run_batch(std::uint32_t worlds, std::uint32_t steps, bool mixed)
+{
+  std::unordered_multimap<std::uint32_t, we::kernel> kernels{};
+
+  we::system::create_kernels(kernels);
+
+  for (auto& [channel, kernel] : kernels)
+  {
+    we::system::compute_kernel(kernel);
+  }
+
+  std::random_device random{};
+  std::mt19937 generator{ random() };
+  std::uniform_real_distribution<std::float_t> dist{ 0.0f, 1.0f };
+
+  std::vector<std::float_t> state{};
+  std::vector<std::float_t> seed{};
+
+  state.resize(s_batch_width * s_batch_height * 4);
+  seed.resize(10 * 10 * 4);
+
+  we::batch batch{ s_batch_width, s_batch_height, 10, 10, worlds, 0 };
+
+  // Same kernels everywhere so the whole batch shares one set, unless mixed sizes are asked for
+  std::uniform_int_distribution<std::uint32_t> size_dist{ 3, 30 };
+  std::unordered_multimap<std::uint32_t, we::kernel> world_kernels{ kernels };
+
+  for (std::uint32_t world{}; world < worlds; world++)
+  {
+    for (std::uint32_t i{}; i < state.size(); i++) state[i] = (i % 4 == 3) ? 1.0f : dist(generator);
+    for (std::uint32_t i{}; i < seed.size(); i++) seed[i] = (i % 4 == 3) ? 1.0f : dist(generator);
+
+    if (mixed)
+    {
+      for (auto& [channel, kernel] : world_kernels)
+      {
+        kernel.size = size_dist(generator);
+
+        we::system::compute_kernel(kernel);
+      }
+    }
+
+    batch.set_kernels(world, world_kernels);
+    batch.set_state(world, state);
+    batch.set_generator(world, seed);
+  }
+
+  for (std::uint32_t i{}; i < steps; i++)
+  {
+    batch.step();
+  }
+
+  std::printf("Stepped %u worlds of %ux%u %u times with %u kernel sets on %u threads, %.0f world steps/s, %.0f cells/s\n", worlds, s_batch_width, s_batch_height, steps, batch.get_set_count(), batch.get_thread_count(), batch.get_worlds_per_second(), batch.get_cells_per_second());
+
+  std::uint32_t active{};
+
+  for (std::uint32_t world{}; world < worlds; world++)
+  {
+    active += batch.get_active_bands(world);
+  }
+
+  std::printf("Last step ran %u of %u row bands\n", active, worlds * batch.get_band_count());
+
+  const we::thread_pool& pool{ batch.get_pool() };
+
+  for (std::uint32_t i{}; i < pool.get_thread_count(); i++)
+  {
+    const we::thread_pool::stats& stats{ pool.get_stats(i) };
+
+    std::printf("Worker %u, %.1f%% busy, %llu chunks, %llu stolen\n", i, pool.get_utilization(i) * 100.0, static_cast<unsigned long long>(stats.chunks), static_cast<unsigned long long>(stats.steals));
+  }
+}
+
 ///////////////////////////////////////////////////////////
 // Entry point
 ///////////////////////////////////////////////////////////
 
-std::int32_t main()
+std::int32_t main(std::int32_t argc, char** argv)
 {
+  // Run without window or GL context
+  if (argc > 1 && std::string_view{ argv[1] } == "--headless")
+  {
+    std::uint32_t steps{ (argc > 2) ? static_cast<std::uint32_t>(std::stoul(argv[2])) : s_headless_steps };
+    we::engine::convolution convolution{ (argc > 3 && std::string_view{ argv[3] } == "fft") ? we::engine::e_conv_fft : we::engine::e_conv_direct };
+    std::uint32_t temporal{ (argc > 4 && std::string_view{ argv[3] } == "temporal") ? static_cast<std::uint32_t>(std::stoul(argv[4])) : 1 };
+
+    run_headless(steps, convolution, temporal);
+
+    return 0;
+  }
+
+  // Step many small worlds together without window or GL context
+  if (argc > 1 && std::string_view{ argv[1] } == "--batch")
+  {
+    std::uint32_t worlds{ (argc > 2) ? static_cast<std::uint32_t>(std::stoul(argv[2])) : s_batch_worlds };
+    std::uint32_t steps{ (argc > 3) ? static_cast<std::uint32_t>(std::stoul(argv[3])) : s_headless_steps };
+    bool mixed{ argc > 4 && std::string_view{ argv[4] } == "mixed" };
+
+    run_batch(worlds, steps, mixed);
+
+    return 0;
+  }
+
+  // Fail when a steady-state step allocates on any CPU path
+  if (argc > 1 && std::string_view{ argv[1] } == "--alloc-check")
+  {
+    std::uint32_t steps{ (argc > 2) ? static_cast<std::uint32_t>(std::stoul(argv[2])) : s_alloc_check_steps };
+
+    return run_alloc_check(steps) ? 0 : 1;
+  }
+
+  // Measure the convolution kernels and the kernel generator for each instruction set
+  if (argc > 1 && std::string_view{ argv[1] } == "--benchmark")
+  {
+    we::benchmark::convolution(s_system_width, s_system_height, s_benchmark_repeats);
+    we::benchmark::tiling(s_benchmark_tiling_size, s_benchmark_tiling_repeats);
+    we::benchmark::generation(s_benchmark_generation_shapes, s_benchmark_generation_repeats);
+
+    return 0;
+  }
+
+  // Compare reduced precision storage against fp32 after a number of steps
+  if (argc > 1 && std::string_view{ argv[1] } == "--drift")
+  {
+    std::uint32_t steps{ (argc > 2) ? static_cast<std::uint32_t>(std::stoul(argv[2])) : s_drift_steps };
+
+    we::benchmark::drift(s_system_width, s_system_height, steps, s_drift_interval);
+
+    return 0;
+  }
+
   // Initialize glfw
   if (glfwInit())
   {
@@ -103,6 +417,9 @@ std::int32_t main()
         // Set swap interval
         glfwSwapInterval(0);
 
+        // Compile generated programs on driver threads where supported
+        we::shader::load_parallel(reinterpret_cast<we::shader::loader>(glfwGetProcAddress));
+
         // Create imgui context
         IMGUI_CHECKVERSION();
         ImGuiContext* imgui_context{ ImGui::CreateContext() };
@@ -129,6 +446,15 @@ std::int32_t main()
             s_systems[i] = new we::system{ s_system_width, s_system_height, 10, 10 };
           }
 
+          // Create grid, the first system provides the kernel layout
+          s_grid = new we::grid{ s_system_width, s_system_height, 10, 10, static_cast<std::uint32_t>(s_systems.size()), s_systems[0]->get_kernels() };
+          s_grid_revisions.resize(s_systems.size());
+          for (std::uint32_t i{}; i < s_systems.size(); i++)
+          {
+            s_grid->set_kernels(i, s_systems[i]->get_kernels());
+            s_grid_revisions[i] = s_systems[i]->get_revision();
+          }
+
           while (!glfwWindowShouldClose(window))
           {
             // Compute time
@@ -142,15 +468,39 @@ std::int32_t main()
               s_systems[i]->update();
             }
 
+            // Copy edited kernels into their layers
+            if (s_grid_enabled)
+            {
+              for (std::uint32_t i{}; i < s_systems.size(); i++)
+              {
+                if (s_grid_revisions[i] != s_systems[i]->get_revision())
+                {
+                  s_grid->set_kernels(i, s_systems[i]->get_kernels());
+                  s_grid_revisions[i] = s_systems[i]->get_revision();
+                }
+
+                s_grid->set_growth_table(i, s_systems[i]->get_growth_table());
+              }
+
+              s_grid->update();
+            }
+
             // Capped loop
             if ((s_time - s_time_update_prev) >= (1.0f / s_time_update_fps))
             {
               s_time_update_prev = s_time;
 
               // Swap system buffers
-              for (std::uint32_t i{}; i < s_systems.size(); i++)
+              if (s_grid_enabled)
               {
-                s_systems[i]->swap();
+                s_grid->swap();
+              }
+              else
+              {
+                for (std::uint32_t i{}; i < s_systems.size(); i++)
+                {
+                  s_systems[i]->swap();
+                }
               }
             }
 
@@ -168,14 +518,21 @@ std::int32_t main()
             std::float_t system_width{ static_cast<std::float_t>(s_system_width) * system_scale_x };
             std::float_t system_height{ static_cast<std::float_t>(s_system_height) * system_scale_y };
 
-            for (std::uint32_t x{}; x < s_system_count_x; x++)
+            if (s_grid_enabled)
+            {
+              s_grid->draw(s_system_count_x);
+            }
+            else
             {
-              for (std::uint32_t y{}; y < s_system_count_y; y++)
+              for (std::uint32_t x{}; x < s_system_count_x; x++)
               {
-                std::float_t system_pos_x{ static_cast<std::float_t>(x) * system_width };
-                std::float_t system_pos_y{ static_cast<std::float_t>(y) * system_height };
+                for (std::uint32_t y{}; y < s_system_count_y; y++)
+                {
+                  std::float_t system_pos_x{ static_cast<std::float_t>(x) * system_width };
+                  std::float_t system_pos_y{ static_cast<std::float_t>(y) * system_height };
 
-                s_systems[x + y * s_system_count_x]->draw(system_pos_x, system_pos_y, system_scale_x, system_scale_y);
+                  s_systems[x + y * s_system_count_x]->draw(system_pos_x, system_pos_y, system_scale_x, system_scale_y);
+                }
               }
             }
 
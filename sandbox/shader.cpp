@@ -1,58 +1,288 @@
 #include <string>
 #include <vector>
 #include <fstream>
+#include <iterator>
+#include <filesystem>
+#include <format>
+#include <string_view>
 
 #include <shader.h>
 
 #include <glad/glad.h>
 
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 namespace we
 {
   void shader::create(std::uint32_t& program, const std::string& vertex_source, const std::string& fragment_source)
   {
-    program = glCreateProgram();
+    job job{};
+
+    submit(job, vertex_source, fragment_source);
+    poll(job, true);
+
+    program = job.program;
+  }
+
+  void shader::create(std::uint32_t& program, const std::string& vertex_source, const std::string& geometry_source, const std::string& fragment_source)
+  {
+    job job{};
+
+    submit(job, vertex_source, geometry_source, fragment_source);
+    poll(job, true);
+
+    program = job.program;
+  }
+
+  void shader::create_compute(std::uint32_t& program, const std::string& compute_source)
+  {
+    job job{};
+
+    submit_compute(job, compute_source);
+    poll(job, true);
+
+    program = job.program;
+  }
+
+  void shader::submit(job& job, const std::string& vertex_source, const std::string& fragment_source)
+  {
+    job.key = hash(fragment_source, hash(vertex_source, hash_driver()));
+
+    if (reuse(job)) return;
+
+    job.program = glCreateProgram();
+
+    attach(job, 0, GL_VERTEX_SHADER, vertex_source);
+    attach(job, 1, GL_FRAGMENT_SHADER, fragment_source);
+    link(job);
+  }
 
-    std::uint32_t vid{ glCreateShader(GL_VERTEX_SHADER) };
-    std::uint32_t fid{ glCreateShader(GL_FRAGMENT_SHADER) };
+  void shader::submit(job& job, const std::string& vertex_source, const std::string& geometry_source, const std::string& fragment_source)
+  {
+    job.key = hash(fragment_source, hash(geometry_source, hash(vertex_source, hash_driver())));
+
+    if (reuse(job)) return;
+
+    job.program = glCreateProgram();
+
+    attach(job, 0, GL_VERTEX_SHADER, vertex_source);
+    attach(job, 1, GL_GEOMETRY_SHADER, geometry_source);
+    attach(job, 2, GL_FRAGMENT_SHADER, fragment_source);
+    link(job);
+  }
+
+  void shader::submit_compute(job& job, const std::string& compute_source)
+  {
+    job.key = hash(compute_source, hash_driver());
+
+    if (reuse(job)) return;
+
+    job.program = glCreateProgram();
+
+    attach(job, 0, GL_COMPUTE_SHADER, compute_source);
+    link(job);
+  }
+
+  bool shader::poll(job& job, bool wait)
+  {
+    if (job.done) return true;
+
+    if (s_parallel && !wait)
+    {
+      std::int32_t status{};
+      glGetProgramiv(job.program, GL_COMPLETION_STATUS_KHR, &status);
+
+      if (!status) return false;
+    }
+
+    // Without the extension nothing can be asked without blocking, so the link status below waits.
+    // The first poll lets a frame go by instead, which drivers compiling on their own threads use
+    if (!s_parallel && !wait && !job.polled)
+    {
+      job.polled = true;
+
+      return false;
+    }
 
-    const char* vs{ &vertex_source[0] };
-    glShaderSource(vid, 1, &vs, nullptr);
-    glCompileShader(vid);
-    check_compile_error(vid);
+    bool linked{ check_link_error(job.program) };
+
+    if (linked)
+    {
+      store_binary(job.program, job.key);
+    }
+    else
+    {
+      for (std::uint32_t shader : job.shaders) if (shader) check_compile_error(shader);
+    }
+
+    for (std::uint32_t& shader : job.shaders)
+    {
+      glDeleteShader(shader);
+
+      shader = 0;
+    }
+
+    // A broken program is never registered, so no other job with the same sources picks it up
+    if (!linked)
+    {
+      glDeleteProgram(job.program);
+
+      job.program = 0;
+      job.failed = true;
+      job.done = true;
+
+      return true;
+    }
+
+    // Another job may have finished the same sources in the meantime
+    std::uint32_t program{};
+
+    if (acquire(program, job.key))
+    {
+      glDeleteProgram(job.program);
+
+      job.program = program;
+    }
+    else
+    {
+      track(job.program, job.key);
+    }
+
+    job.done = true;
+
+    return true;
+  }
+
+  void shader::cancel(job& job)
+  {
+    if (job.done)
+    {
+      destroy(job.program);
+    }
+    else
+    {
+      for (std::uint32_t shader : job.shaders) glDeleteShader(shader);
+
+      glDeleteProgram(job.program);
+    }
+
+    job = {};
+  }
+
+  void shader::load_parallel(loader loader)
+  {
+    using max_threads = void(APIENTRYP)(std::uint32_t count);
+
+    std::int32_t count{};
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+    // Same entry point and enums under either name
+    max_threads function{};
+
+    for (std::int32_t i{}; i < count; i++)
+    {
+      std::string_view name{ reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)) };
+
+      if (name == "GL_KHR_parallel_shader_compile") function = reinterpret_cast<max_threads>(loader("glMaxShaderCompilerThreadsKHR"));
+      if (name == "GL_ARB_parallel_shader_compile" && !function) function = reinterpret_cast<max_threads>(loader("glMaxShaderCompilerThreadsARB"));
+    }
 
-    const char* fs{ &fragment_source[0] };
-    glShaderSource(fid, 1, &fs, nullptr);
-    glCompileShader(fid);
-    check_compile_error(fid);
+    if (!function) return;
 
-    glAttachShader(program, vid);
-    glAttachShader(program, fid);
-    glLinkProgram(program);
-    check_link_error(program);
+    // Let the driver pick the number of threads
+    function(0xFFFFFFFF);
 
-    glDeleteShader(vid);
-    glDeleteShader(fid);
+    s_parallel = true;
   }
 
   void shader::destroy(std::uint32_t program)
   {
+    auto it{ s_references.find(program) };
+
+    if (it == s_references.end())
+    {
+      glDeleteProgram(program);
+
+      return;
+    }
+
+    if (--it->second.references) return;
+
+    s_programs.erase(it->second.key);
+    s_references.erase(it);
+
     glDeleteProgram(program);
   }
 
+  bool shader::reuse(job& job)
+  {
+    if (!acquire(job.program, job.key))
+    {
+      if (!load_binary(job.program, job.key)) return false;
+
+      track(job.program, job.key);
+    }
+
+    job.done = true;
+
+    return true;
+  }
+
+  void shader::attach(job& job, std::uint32_t index, std::uint32_t type, const std::string& source)
+  {
+    // Status is only asked for in poll, asking here would wait for the compile
+    std::uint32_t id{ glCreateShader(type) };
+
+    const char* src{ &source[0] };
+    glShaderSource(id, 1, &src, nullptr);
+    glCompileShader(id);
+
+    glAttachShader(job.program, id);
+
+    job.shaders[index] = id;
+  }
+
+  void shader::link(job& job)
+  {
+    glProgramParameteri(job.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(job.program);
+  }
+
+  bool shader::acquire(std::uint32_t& program, std::uint64_t key)
+  {
+    auto it{ s_programs.find(key) };
+
+    if (it == s_programs.end()) return false;
+
+    program = it->second;
+
+    s_references[program].references++;
+
+    return true;
+  }
+
+  void shader::track(std::uint32_t program, std::uint64_t key)
+  {
+    s_programs[key] = program;
+    s_references[program] = { key, 1 };
+  }
+
   void shader::check_compile_error(std::uint32_t shader)
   {
     std::int32_t status{};
     std::int32_t length{};
     std::string log{};
 
-    glGetProgramiv(shader, GL_COMPILE_STATUS, &status);
-    glGetProgramiv(shader, GL_INFO_LOG_LENGTH, &length);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
     
     log.resize(length);
 
     if (!status)
     {
-      glGetProgramInfoLog(shader, length, nullptr, &log[0]);
+      glGetShaderInfoLog(shader, length, nullptr, &log[0]);
 
       if (length)
       {
@@ -61,7 +291,7 @@ namespace we
     }
   }
 
-  void shader::check_link_error(std::uint32_t program)
+  bool shader::check_link_error(std::uint32_t program)
   {
     std::int32_t status{};
     std::int32_t length{};
@@ -81,5 +311,100 @@ namespace we
         std::printf("%s\n", &log[0]);
       }
     }
+
+    return status;
+  }
+
+  bool shader::load_binary(std::uint32_t& program, std::uint64_t key)
+  {
+    std::ifstream stream{ get_binary_path(key), std::ios::binary };
+
+    if (!stream) return false;
+
+    std::uint32_t format{};
+    std::vector<char> binary{};
+
+    stream.read(reinterpret_cast<char*>(&format), sizeof(format));
+
+    if (stream.fail()) return false;
+
+    // Reading through the streambuf never sets eofbit, an empty rest is the only truncation left to catch
+    binary.assign(std::istreambuf_iterator<char>{ stream }, std::istreambuf_iterator<char>{});
+
+    if (binary.empty()) return false;
+
+    program = glCreateProgram();
+
+    glProgramBinary(program, format, &binary[0], static_cast<std::int32_t>(binary.size()));
+
+    // Drivers reject binaries of other versions, which then compile from source and overwrite the entry
+    std::int32_t status{};
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+
+    if (status) return true;
+
+    glDeleteProgram(program);
+
+    program = 0;
+
+    return false;
+  }
+
+  void shader::store_binary(std::uint32_t program, std::uint64_t key)
+  {
+    std::int32_t length{};
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+
+    if (length <= 0) return;
+
+    std::uint32_t format{};
+    std::vector<char> binary{};
+
+    binary.resize(length);
+
+    glGetProgramBinary(program, length, &length, &format, &binary[0]);
+
+    std::error_code error{};
+    std::filesystem::create_directories(s_binary_directory, error);
+
+    if (error) return;
+
+    std::ofstream stream{ get_binary_path(key), std::ios::binary };
+
+    stream.write(reinterpret_cast<const char*>(&format), sizeof(format));
+    stream.write(&binary[0], length);
+  }
+
+  std::filesystem::path shader::get_binary_path(std::uint64_t key)
+  {
+    return s_binary_directory / std::format("{:016x}.bin", key);
+  }
+
+  std::uint64_t shader::hash(const std::string& source, std::uint64_t seed)
+  {
+    // FNV-1a, stable across runs and standard libraries unlike std::hash
+    std::uint64_t value{ seed };
+
+    for (char c : source)
+    {
+      value ^= static_cast<std::uint8_t>(c);
+      value *= 0x100000001B3ull;
+    }
+
+    // Terminate each stage so sources split at a different point do not collide
+    value ^= 0xFF;
+    value *= 0x100000001B3ull;
+
+    return value;
+  }
+
+  std::uint64_t shader::hash_driver()
+  {
+    static const std::uint64_t s_driver
+    {
+      hash(reinterpret_cast<const char*>(glGetString(GL_VERSION)), hash(reinterpret_cast<const char*>(glGetString(GL_RENDERER)), hash(reinterpret_cast<const char*>(glGetString(GL_VENDOR)), 0xCBF29CE484222325ull)))
+    };
+
+    return s_driver;
   }
 }
\ No newline at end of file
@@ -3,6 +3,9 @@
 
 #include <cstdint>
 #include <string>
+#include <array>
+#include <unordered_map>
+#include <filesystem>
 
 namespace we
 {
@@ -48,17 +51,185 @@ namespace we
       )glsl"
     };
 
+    // Rect per instance, routed to the array layer of the same index
+    inline static const std::string s_layer_vertex_source
+    {
+      R"glsl(#version 460 core
+      
+      layout (location = 0) in vec4 i_position;
+      layout (location = 1) in vec4 i_uv;
+      
+      layout (location = 0) out Forward
+      {
+        vec4 uv;
+      } o_fwd;
+      
+      layout (location = 1) flat out int o_layer;
+      
+      void main()
+      {
+        o_fwd.uv = i_uv;
+        o_layer = gl_InstanceID;
+        gl_Position = i_position;
+      }
+      )glsl"
+    };
+    inline static const std::string s_layer_geometry_source
+    {
+      R"glsl(#version 460 core
+      
+      layout (triangles) in;
+      layout (triangle_strip, max_vertices = 3) out;
+      
+      layout (location = 0) in Forward
+      {
+        vec4 uv;
+      } i_fwd[];
+      
+      layout (location = 1) flat in int i_layer[];
+      
+      layout (location = 0) out Forward
+      {
+        vec4 uv;
+      } o_fwd;
+      
+      layout (location = 1) flat out int o_layer;
+      
+      void main()
+      {
+        for (int i = 0; i < 3; i++)
+        {
+          o_fwd.uv = i_fwd[i].uv;
+          o_layer = i_layer[i];
+          gl_Layer = i_layer[i];
+          gl_Position = gl_in[i].gl_Position;
+          EmitVertex();
+        }
+        EndPrimitive();
+      }
+      )glsl"
+    };
+    // Rect per instance, placed in a grid of u_columns by u_rows tiles filling the viewport
+    inline static const std::string s_tile_vertex_source
+    {
+      R"glsl(#version 460 core
+      
+      layout (location = 0) in vec4 i_position;
+      layout (location = 1) in vec4 i_uv;
+      
+      layout (location = 0) out Forward
+      {
+        vec4 uv;
+      } o_fwd;
+      
+      layout (location = 1) flat out int o_layer;
+      
+      layout (location = 0) uniform int u_columns;
+      layout (location = 1) uniform int u_rows;
+      
+      void main()
+      {
+        vec2 tile = vec2(gl_InstanceID % u_columns, gl_InstanceID / u_columns);
+        vec2 corner = i_position.xy * 0.5 + 0.5;
+        
+        o_fwd.uv = i_uv;
+        o_layer = gl_InstanceID;
+        gl_Position = vec4(((tile + corner) / vec2(u_columns, u_rows)) * 2.0 - 1.0, 0.0, 1.0);
+      }
+      )glsl"
+    };
+    inline static const std::string s_tile_fragment_source
+    {
+      R"glsl(#version 460 core
+      
+      layout (location = 0) in Forward
+      {
+        vec4 uv;
+      } i_fwd;
+      
+      layout (location = 1) flat in int i_layer;
+      
+      layout (location = 0) out vec4 o_color;
+      
+      layout (location = 2) uniform sampler2DArray u_texture;
+      
+      void main()
+      {
+        o_color = texture(u_texture, vec3(i_fwd.uv.xy, float(i_layer)));
+      }
+      )glsl"
+    };
+
+  public:
+    // Program whose link may still be running on driver threads, see submit and poll
+    struct job
+    {
+      std::uint32_t program{};
+      std::uint64_t key{};
+      std::array<std::uint32_t, 3> shaders{};
+      bool polled{};
+      bool failed{};
+      bool done{};
+    };
+
+    using loader = void* (*)(const char* name);
+
   public:
     shader() = delete;
 
   public:
     static void create(std::uint32_t& program, const std::string& vertex_source, const std::string& fragment_source);
+    static void create(std::uint32_t& program, const std::string& vertex_source, const std::string& geometry_source, const std::string& fragment_source);
+    static void create_compute(std::uint32_t& program, const std::string& compute_source);
+
+    // Same as create without waiting, poll reports when the job is done. A failed link leaves program at 0 and sets failed
+    static void submit(job& job, const std::string& vertex_source, const std::string& fragment_source);
+    static void submit(job& job, const std::string& vertex_source, const std::string& geometry_source, const std::string& fragment_source);
+    static void submit_compute(job& job, const std::string& compute_source);
+    static bool poll(job& job, bool wait = false);
+    static void cancel(job& job);
+
+    // Hands compiles to driver threads when GL_KHR_parallel_shader_compile is present
+    static void load_parallel(loader loader);
 
     static void destroy(std::uint32_t program);
 
+  private:
+    static bool reuse(job& job);
+    static void attach(job& job, std::uint32_t index, std::uint32_t type, const std::string& source);
+    static void link(job& job);
+
   private:
     static void check_compile_error(std::uint32_t shader);
-    static void check_link_error(std::uint32_t program);
+    static bool check_link_error(std::uint32_t program);
+
+  private:
+    // Linked programs are kept on disk under a hash of their sources and the driver strings
+    static bool load_binary(std::uint32_t& program, std::uint64_t key);
+    static void store_binary(std::uint32_t program, std::uint64_t key);
+    static std::filesystem::path get_binary_path(std::uint64_t key);
+    static std::uint64_t hash(const std::string& source, std::uint64_t seed);
+    static std::uint64_t hash_driver();
+
+  private:
+    // Programs with the same sources are shared, destroy only deletes once the last user is gone
+    static bool acquire(std::uint32_t& program, std::uint64_t key);
+    static void track(std::uint32_t program, std::uint64_t key);
+
+  private:
+    struct reference
+    {
+      std::uint64_t key{};
+      std::uint32_t references{};
+    };
+
+  private:
+    inline static std::unordered_map<std::uint64_t, std::uint32_t> s_programs{};
+    inline static std::unordered_map<std::uint32_t, reference> s_references{};
+
+    inline static bool s_parallel{};
+
+    inline static const std::filesystem::path s_binary_directory{ "programs" };
   };
 }
 
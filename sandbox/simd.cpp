@@ -0,0 +1,491 @@
+#include <limits>
+#include <algorithm>
+
+#include <simd.h>
+
+#if defined(_M_X64) || defined(__x86_64__)
+  #define WE_SIMD_X64
+  #include <immintrin.h>
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+    #define WE_TARGET_AVX2
+    #define WE_TARGET_AVX512
+  #else
+    #include <cpuid.h>
+    #define WE_TARGET_AVX2 __attribute__((target("avx2,fma")))
+    #define WE_TARGET_AVX512 __attribute__((target("avx512f")))
+  #endif
+#endif
+
+namespace we
+{
+  // Cephes single precision sine, within a few ulp of sinf while the argument is reduced
+  // exactly, which holds up to s_sin_limit. Larger arguments go through std::sin.
+  static const std::float_t s_sin_limit{ 8192.0f };
+  static const std::float_t s_four_over_pi{ 1.27323954473516f };
+  static const std::float_t s_pi_over_four_0{ 0.78515625f };
+  static const std::float_t s_pi_over_four_1{ 2.4187564849853515625e-4f };
+  static const std::float_t s_pi_over_four_2{ 3.77489497744594108e-8f };
+  static const std::float_t s_sin_0{ -1.9515295891e-4f };
+  static const std::float_t s_sin_1{ 8.3321608736e-3f };
+  static const std::float_t s_sin_2{ -1.6666654611e-1f };
+  static const std::float_t s_cos_0{ 2.443315711809948e-5f };
+  static const std::float_t s_cos_1{ -1.388731625493765e-3f };
+  static const std::float_t s_cos_2{ 4.166664568298827e-2f };
+
+#ifdef WE_SIMD_X64
+  static void cpuid(std::uint32_t leaf, std::uint32_t subleaf, std::uint32_t (&regs)[4])
+  {
+#if defined(_MSC_VER)
+    std::int32_t values[4]{};
+    __cpuidex(values, leaf, subleaf);
+    for (std::uint32_t i{}; i < 4; i++) regs[i] = static_cast<std::uint32_t>(values[i]);
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+  }
+
+  static std::uint64_t xgetbv()
+  {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    std::uint32_t eax{};
+    std::uint32_t edx{};
+    __asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<std::uint64_t>(edx) << 32) | eax;
+#endif
+  }
+#endif
+
+  simd::isa simd::detect()
+  {
+#ifdef WE_SIMD_X64
+    std::uint32_t regs[4]{};
+
+    cpuid(0, 0, regs);
+    std::uint32_t max_leaf{ regs[0] };
+    if (max_leaf < 7) return e_isa_scalar;
+
+    cpuid(1, 0, regs);
+    bool osxsave{ (regs[2] & (1u << 27)) != 0 };
+    bool avx{ (regs[2] & (1u << 28)) != 0 };
+    bool fma{ (regs[2] & (1u << 12)) != 0 };
+    if (!osxsave || !avx || !fma) return e_isa_scalar;
+
+    // The OS has to save ymm and zmm state for the wider paths to be usable
+    std::uint64_t xcr0{ xgetbv() };
+    if ((xcr0 & 0x6) != 0x6) return e_isa_scalar;
+
+    cpuid(7, 0, regs);
+    bool avx2{ (regs[1] & (1u << 5)) != 0 };
+    bool avx512{ (regs[1] & (1u << 16)) != 0 };
+
+    if (avx512 && (xcr0 & 0xE6) == 0xE6) return e_isa_avx512;
+    if (avx2) return e_isa_avx2;
+#endif
+
+    return e_isa_scalar;
+  }
+
+  std::uint32_t simd::detect_l2_size()
+  {
+    std::uint32_t size{ 256 * 1024 };
+
+#ifdef WE_SIMD_X64
+    std::uint32_t regs[4]{};
+
+    cpuid(0x80000000, 0, regs);
+    if (regs[0] < 0x80000006) return size;
+
+    // Both vendors report the L2 size in KiB in the upper half of ecx
+    cpuid(0x80000006, 0, regs);
+    std::uint32_t kib{ regs[2] >> 16 };
+    if (kib) size = kib * 1024;
+#endif
+
+    return size;
+  }
+
+  const char* simd::get_name(isa isa)
+  {
+    switch (isa)
+    {
+      case e_isa_avx2: return "avx2";
+      case e_isa_avx512: return "avx512";
+      default: return "scalar";
+    }
+  }
+
+  void simd::convolve_row(isa isa, const std::float_t* src, std::uint32_t stride, const std::float_t* weights, std::uint32_t size, std::float_t* dst, std::uint32_t width)
+  {
+    switch (isa)
+    {
+#ifdef WE_SIMD_X64
+      case e_isa_avx2: convolve_row_avx2(src, stride, weights, size, dst, width); break;
+      case e_isa_avx512: convolve_row_avx512(src, stride, weights, size, dst, width); break;
+#endif
+      default: convolve_row_scalar(src, stride, weights, size, dst, width); break;
+    }
+  }
+
+  void simd::convolve_row_scalar(const std::float_t* src, std::uint32_t stride, const std::float_t* weights, std::uint32_t size, std::float_t* dst, std::uint32_t width)
+  {
+    for (std::uint32_t x{}; x < width; x++)
+    {
+      std::float_t sum{};
+
+      for (std::uint32_t j{}; j < size; j++)
+      {
+        const std::float_t* row{ src + j * stride + x };
+        const std::float_t* w{ weights + j * size };
+
+        for (std::uint32_t i{}; i < size; i++)
+        {
+          sum += w[i] * row[i];
+        }
+      }
+
+      dst[x] = sum;
+    }
+  }
+
+  void simd::generate_row(isa isa, std::float_t x0, std::float_t y, std::float_t offset, std::float_t distance, std::uint32_t sharpness, std::float_t* dst, std::uint32_t width)
+  {
+    switch (isa)
+    {
+#ifdef WE_SIMD_X64
+      case e_isa_avx2: generate_row_avx2(x0, y, offset, distance, sharpness, dst, width); break;
+      case e_isa_avx512: generate_row_avx512(x0, y, offset, distance, sharpness, dst, width); break;
+#endif
+      default: generate_row_scalar(x0, y, offset, distance, sharpness, dst, width); break;
+    }
+  }
+
+  void simd::generate_row_scalar(std::float_t x0, std::float_t y, std::float_t offset, std::float_t distance, std::uint32_t sharpness, std::float_t* dst, std::uint32_t width)
+  {
+    for (std::uint32_t i{}; i < width; i++)
+    {
+      std::float_t x{ x0 + static_cast<std::float_t>(i) };
+      std::float_t l{ std::sqrt(x * x + y * y) };
+      std::float_t m{ l + offset };
+
+      dst[i] = generate_tap((m * m) / distance, sharpness);
+    }
+  }
+
+  std::float_t simd::generate_tap(std::float_t arg, std::uint32_t sharpness)
+  {
+    std::float_t a{ std::fabs(arg) };
+    std::float_t s{};
+
+    if (a <= s_sin_limit)
+    {
+      std::int32_t j{ (static_cast<std::int32_t>(a * s_four_over_pi) + 1) & ~1 };
+      std::float_t q{ static_cast<std::float_t>(j) };
+      std::float_t r{ ((a - q * s_pi_over_four_0) - q * s_pi_over_four_1) - q * s_pi_over_four_2 };
+      std::float_t z{ r * r };
+
+      s = (j & 2)
+        ? ((s_cos_0 * z + s_cos_1) * z + s_cos_2) * z * z - 0.5f * z + 1.0f
+        : ((s_sin_0 * z + s_sin_1) * z + s_sin_2) * z * r + r;
+
+      if ((j & 4) != (arg < 0.0f ? 4 : 0)) s = -s;
+    }
+    else
+    {
+      s = std::sin(arg);
+    }
+
+    std::float_t v{ 1.0f };
+
+    for (std::uint32_t e{ sharpness }; e; e >>= 1)
+    {
+      if (e & 1) v *= s;
+
+      s *= s;
+    }
+
+    // Also zero for a NaN from an argument that was not finite
+    bool finite{ a <= std::numeric_limits<std::float_t>::max() };
+    bool normal{ v >= std::numeric_limits<std::float_t>::min() };
+
+    return finite && normal ? std::min(v, 1.0f) : 0.0f;
+  }
+
+#ifdef WE_SIMD_X64
+  // Four accumulators per pass so every broadcast tap is reused for 32 output cells
+  WE_TARGET_AVX2 void simd::convolve_row_avx2(const std::float_t* src, std::uint32_t stride, const std::float_t* weights, std::uint32_t size, std::float_t* dst, std::uint32_t width)
+  {
+    std::uint32_t x{};
+
+    for (; x + 32 <= width; x += 32)
+    {
+      __m256 acc0{ _mm256_setzero_ps() };
+      __m256 acc1{ _mm256_setzero_ps() };
+      __m256 acc2{ _mm256_setzero_ps() };
+      __m256 acc3{ _mm256_setzero_ps() };
+
+      for (std::uint32_t j{}; j < size; j++)
+      {
+        const std::float_t* row{ src + j * stride + x };
+        const std::float_t* w{ weights + j * size };
+
+        for (std::uint32_t i{}; i < size; i++)
+        {
+          __m256 tap{ _mm256_broadcast_ss(w + i) };
+
+          acc0 = _mm256_fmadd_ps(tap, _mm256_loadu_ps(row + i + 0), acc0);
+          acc1 = _mm256_fmadd_ps(tap, _mm256_loadu_ps(row + i + 8), acc1);
+          acc2 = _mm256_fmadd_ps(tap, _mm256_loadu_ps(row + i + 16), acc2);
+          acc3 = _mm256_fmadd_ps(tap, _mm256_loadu_ps(row + i + 24), acc3);
+        }
+      }
+
+      _mm256_storeu_ps(dst + x + 0, acc0);
+      _mm256_storeu_ps(dst + x + 8, acc1);
+      _mm256_storeu_ps(dst + x + 16, acc2);
+      _mm256_storeu_ps(dst + x + 24, acc3);
+    }
+
+    for (; x + 8 <= width; x += 8)
+    {
+      __m256 acc{ _mm256_setzero_ps() };
+
+      for (std::uint32_t j{}; j < size; j++)
+      {
+        const std::float_t* row{ src + j * stride + x };
+        const std::float_t* w{ weights + j * size };
+
+        for (std::uint32_t i{}; i < size; i++)
+        {
+          acc = _mm256_fmadd_ps(_mm256_broadcast_ss(w + i), _mm256_loadu_ps(row + i), acc);
+        }
+      }
+
+      _mm256_storeu_ps(dst + x, acc);
+    }
+
+    // Masked rather than scalar so every cell gets the same fused sum wherever the row splits
+    if (x < width)
+    {
+      __m256i mask{ _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<std::int32_t>(width - x)), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)) };
+      __m256 acc{ _mm256_setzero_ps() };
+
+      for (std::uint32_t j{}; j < size; j++)
+      {
+        const std::float_t* row{ src + j * stride + x };
+        const std::float_t* w{ weights + j * size };
+
+        for (std::uint32_t i{}; i < size; i++)
+        {
+          acc = _mm256_fmadd_ps(_mm256_broadcast_ss(w + i), _mm256_maskload_ps(row + i, mask), acc);
+        }
+      }
+
+      _mm256_maskstore_ps(dst + x, mask, acc);
+    }
+  }
+
+  WE_TARGET_AVX512 void simd::convolve_row_avx512(const std::float_t* src, std::uint32_t stride, const std::float_t* weights, std::uint32_t size, std::float_t* dst, std::uint32_t width)
+  {
+    std::uint32_t x{};
+
+    for (; x + 64 <= width; x += 64)
+    {
+      __m512 acc0{ _mm512_setzero_ps() };
+      __m512 acc1{ _mm512_setzero_ps() };
+      __m512 acc2{ _mm512_setzero_ps() };
+      __m512 acc3{ _mm512_setzero_ps() };
+
+      for (std::uint32_t j{}; j < size; j++)
+      {
+        const std::float_t* row{ src + j * stride + x };
+        const std::float_t* w{ weights + j * size };
+
+        for (std::uint32_t i{}; i < size; i++)
+        {
+          __m512 tap{ _mm512_set1_ps(w[i]) };
+
+          acc0 = _mm512_fmadd_ps(tap, _mm512_loadu_ps(row + i + 0), acc0);
+          acc1 = _mm512_fmadd_ps(tap, _mm512_loadu_ps(row + i + 16), acc1);
+          acc2 = _mm512_fmadd_ps(tap, _mm512_loadu_ps(row + i + 32), acc2);
+          acc3 = _mm512_fmadd_ps(tap, _mm512_loadu_ps(row + i + 48), acc3);
+        }
+      }
+
+      _mm512_storeu_ps(dst + x + 0, acc0);
+      _mm512_storeu_ps(dst + x + 16, acc1);
+      _mm512_storeu_ps(dst + x + 32, acc2);
+      _mm512_storeu_ps(dst + x + 48, acc3);
+    }
+
+    for (; x + 16 <= width; x += 16)
+    {
+      __m512 acc{ _mm512_setzero_ps() };
+
+      for (std::uint32_t j{}; j < size; j++)
+      {
+        const std::float_t* row{ src + j * stride + x };
+        const std::float_t* w{ weights + j * size };
+
+        for (std::uint32_t i{}; i < size; i++)
+        {
+          acc = _mm512_fmadd_ps(_mm512_set1_ps(w[i]), _mm512_loadu_ps(row + i), acc);
+        }
+      }
+
+      _mm512_storeu_ps(dst + x, acc);
+    }
+
+    if (x < width)
+    {
+      __mmask16 mask{ static_cast<__mmask16>((1u << (width - x)) - 1) };
+      __m512 acc{ _mm512_setzero_ps() };
+
+      for (std::uint32_t j{}; j < size; j++)
+      {
+        const std::float_t* row{ src + j * stride + x };
+        const std::float_t* w{ weights + j * size };
+
+        for (std::uint32_t i{}; i < size; i++)
+        {
+          acc = _mm512_fmadd_ps(_mm512_set1_ps(w[i]), _mm512_maskz_loadu_ps(mask, row + i), acc);
+        }
+      }
+
+      _mm512_mask_storeu_ps(dst + x, mask, acc);
+    }
+  }
+
+  WE_TARGET_AVX2 void simd::generate_row_avx2(std::float_t x0, std::float_t y, std::float_t offset, std::float_t distance, std::uint32_t sharpness, std::float_t* dst, std::uint32_t width)
+  {
+    const __m256 sign{ _mm256_set1_ps(-0.0f) };
+    const __m256 one{ _mm256_set1_ps(1.0f) };
+    const __m256i lanes{ _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7) };
+
+    for (std::uint32_t x{}; x < width; x += 8)
+    {
+      __m256 px{ _mm256_add_ps(_mm256_set1_ps(x0), _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(static_cast<std::int32_t>(x)), lanes))) };
+      __m256 l{ _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(px, px), _mm256_set1_ps(y * y))) };
+      __m256 m{ _mm256_add_ps(l, _mm256_set1_ps(offset)) };
+      __m256 arg{ _mm256_div_ps(_mm256_mul_ps(m, m), _mm256_set1_ps(distance)) };
+      __m256 a{ _mm256_andnot_ps(sign, arg) };
+
+      // Reduce to [-pi/4, pi/4], the octant picks the polynomial and the sign
+      __m256i j{ _mm256_and_si256(_mm256_add_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(a, _mm256_set1_ps(s_four_over_pi))), _mm256_set1_epi32(1)), _mm256_set1_epi32(~1)) };
+      __m256 q{ _mm256_cvtepi32_ps(j) };
+      __m256 r{ _mm256_sub_ps(_mm256_sub_ps(_mm256_sub_ps(a, _mm256_mul_ps(q, _mm256_set1_ps(s_pi_over_four_0))), _mm256_mul_ps(q, _mm256_set1_ps(s_pi_over_four_1))), _mm256_mul_ps(q, _mm256_set1_ps(s_pi_over_four_2))) };
+      __m256 z{ _mm256_mul_ps(r, r) };
+
+      __m256 c{ _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(s_cos_0), z), _mm256_set1_ps(s_cos_1)) };
+      c = _mm256_add_ps(_mm256_mul_ps(c, z), _mm256_set1_ps(s_cos_2));
+      c = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(c, z), z), _mm256_mul_ps(_mm256_set1_ps(0.5f), z)), one);
+
+      __m256 p{ _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(s_sin_0), z), _mm256_set1_ps(s_sin_1)) };
+      p = _mm256_add_ps(_mm256_mul_ps(p, z), _mm256_set1_ps(s_sin_2));
+      p = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(p, z), r), r);
+
+      __m256 cosine{ _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(j, _mm256_set1_epi32(2)), _mm256_set1_epi32(2))) };
+      __m256 flip{ _mm256_xor_ps(_mm256_and_ps(arg, sign), _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(j, _mm256_set1_epi32(4)), 29))) };
+      __m256 s{ _mm256_xor_ps(_mm256_blendv_ps(p, c, cosine), flip) };
+
+      __m256 v{ one };
+
+      for (std::uint32_t e{ sharpness }; e; e >>= 1)
+      {
+        if (e & 1) v = _mm256_mul_ps(v, s);
+
+        s = _mm256_mul_ps(s, s);
+      }
+
+      // Selects instead of FP exception flags, NaN compares false and drops out with the underflow
+      __m256 finite{ _mm256_cmp_ps(a, _mm256_set1_ps(std::numeric_limits<std::float_t>::max()), _CMP_LE_OQ) };
+      __m256 normal{ _mm256_cmp_ps(v, _mm256_set1_ps(std::numeric_limits<std::float_t>::min()), _CMP_GE_OQ) };
+      __m256 large{ _mm256_andnot_ps(_mm256_cmp_ps(a, _mm256_set1_ps(s_sin_limit), _CMP_LE_OQ), finite) };
+
+      v = _mm256_and_ps(_mm256_min_ps(v, one), _mm256_and_ps(finite, normal));
+
+      std::uint32_t count{ std::min(width - x, 8u) };
+
+      if (count == 8)
+      {
+        _mm256_storeu_ps(dst + x, v);
+      }
+      else
+      {
+        _mm256_maskstore_ps(dst + x, _mm256_cmpgt_epi32(_mm256_set1_epi32(static_cast<std::int32_t>(count)), lanes), v);
+      }
+
+      // Rare, only for a distance small enough to push the argument past the reduction
+      if (std::uint32_t mask{ static_cast<std::uint32_t>(_mm256_movemask_ps(large)) })
+      {
+        alignas(32) std::float_t args[8]{};
+        _mm256_store_ps(args, arg);
+
+        for (std::uint32_t k{}; k < count; k++) if (mask & (1u << k)) dst[x + k] = generate_tap(args[k], sharpness);
+      }
+    }
+  }
+
+  WE_TARGET_AVX512 void simd::generate_row_avx512(std::float_t x0, std::float_t y, std::float_t offset, std::float_t distance, std::uint32_t sharpness, std::float_t* dst, std::uint32_t width)
+  {
+    const __m512i sign{ _mm512_set1_epi32(static_cast<std::int32_t>(0x80000000u)) };
+    const __m512 one{ _mm512_set1_ps(1.0f) };
+    const __m512i lanes{ _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15) };
+
+    for (std::uint32_t x{}; x < width; x += 16)
+    {
+      __m512 px{ _mm512_add_ps(_mm512_set1_ps(x0), _mm512_cvtepi32_ps(_mm512_add_epi32(_mm512_set1_epi32(static_cast<std::int32_t>(x)), lanes))) };
+      __m512 l{ _mm512_sqrt_ps(_mm512_add_ps(_mm512_mul_ps(px, px), _mm512_set1_ps(y * y))) };
+      __m512 m{ _mm512_add_ps(l, _mm512_set1_ps(offset)) };
+      __m512 arg{ _mm512_div_ps(_mm512_mul_ps(m, m), _mm512_set1_ps(distance)) };
+      __m512 a{ _mm512_abs_ps(arg) };
+
+      __m512i j{ _mm512_and_epi32(_mm512_add_epi32(_mm512_cvttps_epi32(_mm512_mul_ps(a, _mm512_set1_ps(s_four_over_pi))), _mm512_set1_epi32(1)), _mm512_set1_epi32(~1)) };
+      __m512 q{ _mm512_cvtepi32_ps(j) };
+      __m512 r{ _mm512_sub_ps(_mm512_sub_ps(_mm512_sub_ps(a, _mm512_mul_ps(q, _mm512_set1_ps(s_pi_over_four_0))), _mm512_mul_ps(q, _mm512_set1_ps(s_pi_over_four_1))), _mm512_mul_ps(q, _mm512_set1_ps(s_pi_over_four_2))) };
+      __m512 z{ _mm512_mul_ps(r, r) };
+
+      __m512 c{ _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(s_cos_0), z), _mm512_set1_ps(s_cos_1)) };
+      c = _mm512_add_ps(_mm512_mul_ps(c, z), _mm512_set1_ps(s_cos_2));
+      c = _mm512_add_ps(_mm512_sub_ps(_mm512_mul_ps(_mm512_mul_ps(c, z), z), _mm512_mul_ps(_mm512_set1_ps(0.5f), z)), one);
+
+      __m512 p{ _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(s_sin_0), z), _mm512_set1_ps(s_sin_1)) };
+      p = _mm512_add_ps(_mm512_mul_ps(p, z), _mm512_set1_ps(s_sin_2));
+      p = _mm512_add_ps(_mm512_mul_ps(_mm512_mul_ps(p, z), r), r);
+
+      __mmask16 cosine{ _mm512_test_epi32_mask(j, _mm512_set1_epi32(2)) };
+      __m512i flip{ _mm512_xor_si512(_mm512_and_si512(_mm512_castps_si512(arg), sign), _mm512_slli_epi32(_mm512_and_si512(j, _mm512_set1_epi32(4)), 29)) };
+      __m512 s{ _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(_mm512_mask_blend_ps(cosine, p, c)), flip)) };
+
+      __m512 v{ one };
+
+      for (std::uint32_t e{ sharpness }; e; e >>= 1)
+      {
+        if (e & 1) v = _mm512_mul_ps(v, s);
+
+        s = _mm512_mul_ps(s, s);
+      }
+
+      __mmask16 finite{ _mm512_cmp_ps_mask(a, _mm512_set1_ps(std::numeric_limits<std::float_t>::max()), _CMP_LE_OQ) };
+      __mmask16 normal{ _mm512_cmp_ps_mask(v, _mm512_set1_ps(std::numeric_limits<std::float_t>::min()), _CMP_GE_OQ) };
+      __mmask16 large{ static_cast<__mmask16>(finite & ~_mm512_cmp_ps_mask(a, _mm512_set1_ps(s_sin_limit), _CMP_LE_OQ)) };
+
+      v = _mm512_maskz_mov_ps(static_cast<__mmask16>(finite & normal), _mm512_min_ps(v, one));
+
+      std::uint32_t count{ std::min(width - x, 16u) };
+
+      _mm512_mask_storeu_ps(dst + x, static_cast<__mmask16>((1u << count) - 1), v);
+
+      if (large)
+      {
+        alignas(64) std::float_t args[16]{};
+        _mm512_store_ps(args, arg);
+
+        for (std::uint32_t k{}; k < count; k++) if (large & (1u << k)) dst[x + k] = generate_tap(args[k], sharpness);
+      }
+    }
+  }
+#endif
+}
\ No newline at end of file
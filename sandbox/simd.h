@@ -0,0 +1,52 @@
+#ifndef WE_SIMD_H
+#define WE_SIMD_H
+
+#include <cstdint>
+#include <cmath>
+
+namespace we
+{
+  class simd
+  {
+  public:
+    enum isa
+    {
+      e_isa_scalar,
+      e_isa_avx2,
+      e_isa_avx512,
+    };
+
+  public:
+    simd() = delete;
+
+  public:
+    static isa detect();
+    static const char* get_name(isa isa);
+
+    // Per core L2 size in bytes from cpuid, 256 KiB when the CPU does not report it
+    static std::uint32_t detect_l2_size();
+
+  public:
+    // Convolves one output row. `src` points at the top left tap of the first output
+    // cell inside a padded plane, `weights` is the kernel as `size` rows of `size` taps.
+    static void convolve_row(isa isa, const std::float_t* src, std::uint32_t stride, const std::float_t* weights, std::uint32_t size, std::float_t* dst, std::uint32_t width);
+
+    // Generates one row of kernel taps, sin((l + offset)^2 / distance)^sharpness clamped to
+    // [0, 1] where `l` is the distance of tap (x0 + i, y) from the centre. Taps whose argument
+    // is not finite or whose power underflows are zero, as they were under the old FP checks.
+    static void generate_row(isa isa, std::float_t x0, std::float_t y, std::float_t offset, std::float_t distance, std::uint32_t sharpness, std::float_t* dst, std::uint32_t width);
+
+  private:
+    static void convolve_row_scalar(const std::float_t* src, std::uint32_t stride, const std::float_t* weights, std::uint32_t size, std::float_t* dst, std::uint32_t width);
+    static void convolve_row_avx2(const std::float_t* src, std::uint32_t stride, const std::float_t* weights, std::uint32_t size, std::float_t* dst, std::uint32_t width);
+    static void convolve_row_avx512(const std::float_t* src, std::uint32_t stride, const std::float_t* weights, std::uint32_t size, std::float_t* dst, std::uint32_t width);
+
+    static void generate_row_scalar(std::float_t x0, std::float_t y, std::float_t offset, std::float_t distance, std::uint32_t sharpness, std::float_t* dst, std::uint32_t width);
+    static void generate_row_avx2(std::float_t x0, std::float_t y, std::float_t offset, std::float_t distance, std::uint32_t sharpness, std::float_t* dst, std::uint32_t width);
+    static void generate_row_avx512(std::float_t x0, std::float_t y, std::float_t offset, std::float_t distance, std::uint32_t sharpness, std::float_t* dst, std::uint32_t width);
+
+    static std::float_t generate_tap(std::float_t arg, std::uint32_t sharpness);
+  };
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,27 @@
+#include <sparse.h>
+
+namespace we
+{
+  void sparse::gather(kernel& kernel, std::float_t cutoff)
+  {
+    kernel.taps.clear();
+
+    for (std::uint32_t i{}; i < kernel.size; i++)
+    {
+      for (std::uint32_t j{}; j < kernel.size; j++)
+      {
+        std::float_t weight{ kernel.values[i + j * kernel.size] };
+
+        if (std::fabs(weight) > cutoff)
+        {
+          std::int32_t dx{ static_cast<std::int32_t>(i) - static_cast<std::int32_t>(kernel.size / 2) };
+          std::int32_t dy{ static_cast<std::int32_t>(j) - static_cast<std::int32_t>(kernel.size / 2) };
+
+          kernel.taps.emplace_back(tap{ dx, dy, weight });
+        }
+      }
+    }
+
+    kernel.density = kernel.size ? static_cast<std::float_t>(kernel.taps.size()) / (kernel.size * kernel.size) : 0.0f;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#ifndef WE_SPARSE_H
+#define WE_SPARSE_H
+
+#include <cstdint>
+#include <cmath>
+
+#include <system.h>
+
+namespace we
+{
+  class sparse
+  {
+  public:
+    sparse() = delete;
+
+  public:
+    // Collects every tap with a weight above `cutoff` in the shader's i, j order
+    static void gather(kernel& kernel, std::float_t cutoff);
+  };
+}
+
+#endif
\ No newline at end of file
@@ -1,13 +1,19 @@
 #include <sstream>
 #include <format>
-#include <cfenv>
 #include <random>
+#include <algorithm>
 
 #include <system.h>
+#include <engine.h>
+#include <lowrank.h>
+#include <sparse.h>
+#include <simd.h>
+#include <growth_table.h>
 #include <texture.h>
 #include <shader.h>
 #include <framebuffer.h>
 #include <vao.h>
+#include <buffer.h>
 
 #include <glad/glad.h>
 
@@ -36,51 +42,90 @@ namespace we
     vao::create(m_vaos[e_vao_rect], 4, &vao::s_rect_vertices[0], 6, &vao::s_rect_elements[0]);
 
     // Add kernels
-    m_kernels.emplace(0, kernel{ "r0", 0, 1.0f, 22, 95.546f, 101.467f, 4, growth{ 14.744f, 1.361f, 9.773f, 4 } });
-    m_kernels.emplace(0, kernel{ "r1", 0, 1.0f, 14, 27.401f, 201.791f, 10, growth{ 7.503f, 1.056f, 5.234f, 8 } });
-    m_kernels.emplace(0, kernel{ "r2", 0, 1.0f, 26, 72.666f, 355.859f, 3, growth{ 14.210f, 0.311f, 2.862f, 1 } });
+    create_kernels(m_kernels);
 
-    m_kernels.emplace(1, kernel{ "g0", 1, 1.0f, 13, 89.537f, 310.026f, 4, growth{ 19.295f, 1.32f, 6.475f, 13 } });
-    m_kernels.emplace(1, kernel{ "g1", 1, 1.0f, 26, 33.693f, 199.018f, 2, growth{ 17.667f, 1.678f, 2.314f, 20 } });
-    m_kernels.emplace(1, kernel{ "g2", 1, 1.0f, 27, 85.988f, 408.609f, 8, growth{ 18.425f, 0.01f, 8.164f, 14 } });
+    // Give every kernel its second buffer
+    for (auto& [channel, kernel] : m_kernels)
+    {
+      kernel.slot = static_cast<std::uint32_t>(m_slots.size());
+
+      m_slots.emplace_back(std::make_unique<slot>());
 
-    m_kernels.emplace(2, kernel{ "b0", 2, 1.0f, 17, 39.609f, 383.556f, 3, growth{ 15.637f, 0.933f, 2.713f, 2 } });
-    m_kernels.emplace(2, kernel{ "b1", 2, 1.0f, 7, 74.299f, 70.204f, 7, growth{ 14.115f, 1.752f, 5.816f, 10 } });
-    m_kernels.emplace(2, kernel{ "b2", 2, 1.0f, 13, 63.958f, 495.396f, 13, growth{ 2.907f, 1.915f, 2.45f, 1 } });
+      copy_shape(kernel, m_slots.back()->edit);
+    }
 
     // Build initial state
     rebuild_kernel();
+    rebuild_factors();
+    rebuild_taps();
+    rebuild_weights();
+    bind_weights();
     rebuild_shader();
     rebuild_preview();
+
+    finish_shader(true);
   }
 
   void system::update()
   {
+    rebuild_edited();
+
     if (m_dirty)
     {
       m_dirty = 0;
 
+      rebuild_weights();
       rebuild_shader();
     }
+
+    // The current programs keep stepping until every program of the new build has linked
+    finish_shader(false);
+
+    // Every edit so far is now seen by the next step
+    if (m_edit_pending && !m_generating && !m_build.pending)
+    {
+      m_edit_latency = std::chrono::duration<std::double_t, std::milli>(std::chrono::steady_clock::now() - m_edit_time).count();
+      m_edit_pending = false;
+    }
   }
 
   void system::swap()
   {
+    // Compute separable terms
+    if (m_term_groups)
+    {
+      glViewport(0, 0, m_system_width, m_system_height * m_term_groups);
+
+      glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbos[e_fb_terms]);
+
+      glActiveTexture(GL_TEXTURE0);
+      glBindTexture(GL_TEXTURE_2D, m_textures[e_tex_front]);
+
+      glUseProgram(m_programs[e_prog_terms]);
+
+      glBindVertexArray(m_vaos[e_vao_rect]);
+      glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+      glBindVertexArray(0);
+
+      glActiveTexture(GL_TEXTURE1);
+      glBindTexture(GL_TEXTURE_2D, m_textures[e_tex_terms]);
+    }
+
     // Set viewport to system size
     glViewport(0, 0, m_system_width, m_system_height);
 
-    // Compute next state
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbos[e_fb_back]);
-    
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, m_textures[e_tex_front]);
     
-    glUseProgram(m_programs[e_prog_conv]);
+    glUseProgram(m_programs[m_compute_group ? e_prog_compute : e_prog_conv]);
+
+    glUniform2f(m_texture_size_location, static_cast<std::float_t>(m_system_width), static_cast<std::float_t>(m_system_height));
+    glUniform1i(m_fused_before_location, m_bound.fused_before);
+    glUniform1i(m_fused_size_location, m_bound.fused_size);
 
-    glUniform2f(glGetUniformLocation(m_programs[e_prog_conv], "u_texture_size"), static_cast<std::float_t>(m_system_width), static_cast<std::float_t>(m_system_height));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_buffers[e_buf_weights]);
+
+    if (m_bound.growth_table) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, get_growth_buffer());
 
     auto range0{ m_kernels.equal_range(0) };
     auto range1{ m_kernels.equal_range(1) };
@@ -90,27 +135,46 @@ namespace we
     for (auto it{ range1.first }; it != range1.second; it++) update_uniforms(it->second);
     for (auto it{ range2.first }; it != range2.second; it++) update_uniforms(it->second);
 
-    glBindVertexArray(m_vaos[e_vao_rect]);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
-    glBindVertexArray(0);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (m_compute_group)
+    {
+      // Compute next state into back, cells under the generator are written by the same dispatch
+      glActiveTexture(GL_TEXTURE2);
+      glBindTexture(GL_TEXTURE_2D, m_textures[e_tex_gen]);
+      glActiveTexture(GL_TEXTURE0);
 
-    // Copy back to front
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbos[e_fb_back]);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbos[e_fb_front]);
+      glBindImageTexture(0, m_textures[e_tex_back], 0, GL_FALSE, 0, GL_WRITE_ONLY, texture::get_internal_format(m_storage));
 
-    glBlitFramebuffer(0, 0, m_system_width, m_system_height, 0, 0, m_system_width, m_system_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+      glDispatchCompute((m_system_width + m_compute_group - 1) / m_compute_group, (m_system_height + m_compute_group - 1) / m_compute_group, 1);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+      // Image stores are incoherent, make them visible to the next fetch, blit and read back
+      glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
 
-    // Copy generator to front
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbos[e_fb_gen]);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbos[e_fb_front]);
-    
-    glBlitFramebuffer(0, 0, m_generator_width, m_generator_height, (m_system_width / 2), (m_system_height / 2), (m_system_width / 2) + m_generator_width, (m_system_height / 2) + m_generator_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
-    
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+      std::swap(m_textures[e_tex_front], m_textures[e_tex_back]);
+      std::swap(m_fbos[e_fb_front], m_fbos[e_fb_back]);
+    }
+    else
+    {
+      // Compute next state, the rect covers every texel so the target is not cleared
+      glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbos[e_fb_back]);
+
+      glBindVertexArray(m_vaos[e_vao_rect]);
+      glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+      glBindVertexArray(0);
+
+      glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+      // Back becomes front by swapping handles, everything after this reads and writes the new state
+      std::swap(m_textures[e_tex_front], m_textures[e_tex_back]);
+      std::swap(m_fbos[e_fb_front], m_fbos[e_fb_back]);
+
+      // Copy generator to front
+      glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbos[e_fb_gen]);
+      glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbos[e_fb_front]);
+      
+      glBlitFramebuffer(0, 0, m_generator_width, m_generator_height, (m_system_width / 2), (m_system_height / 2), (m_system_width / 2) + m_generator_width, (m_system_height / 2) + m_generator_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+      
+      glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
 
     // Check if system vanished
     m_iteration++;
@@ -136,6 +200,45 @@ namespace we
 
   void system::ui()
   {
+    ImGui::PushID(this);
+
+    ImGui::Text(m_build.pending ? "Program compiling" : "Program ready");
+    ImGui::Text("Edit latency %.3f ms", m_edit_latency);
+
+    if (ImGui::Checkbox("Low Rank", &m_lowrank))
+    {
+      // Edits skip factoring while low rank is off
+      if (m_lowrank) rebuild_factors();
+
+      m_dirty = 1;
+    }
+    if (ImGui::DragFloat("##Rank Error", &m_lowrank_error, 0.001f, 0.0f, 1.0f, "Rank Error %.4f"))
+    {
+      rebuild_factors();
+
+      m_dirty = 1;
+    }
+
+    if (ImGui::Checkbox("Sparse", &m_sparse)) m_dirty = 1;
+    if (ImGui::DragFloat("##Sparse Cutoff", &m_sparse_cutoff, 0.0001f, 0.0f, 1.0f, "Sparse Cutoff %.4f"))
+    {
+      rebuild_taps();
+
+      m_dirty = 1;
+    }
+
+    if (ImGui::Checkbox("Fused", &m_fused)) m_dirty = 1;
+    if (ImGui::Checkbox("Compute", &m_compute)) m_dirty = 1;
+
+    if (ImGui::Checkbox("Growth Table", &m_growth_table)) m_dirty = 1;
+    if (m_growth_table) ImGui::Text("Growth table %u samples, error %.1e", growth_table::get_size(), growth_table::get_error());
+
+    // Half and float buy precision with twice and four times the memory of unorm8
+    std::int32_t storage{ m_storage };
+    if (ImGui::Combo("Storage", &storage, "Unorm8\0Half (precise, 2x memory)\0Float (precise, 4x memory)\0")) rebuild_storage(static_cast<texture::format>(storage));
+
+    ImGui::PopID();
+
     auto range0{ m_kernels.equal_range(0) };
     auto range1{ m_kernels.equal_range(1) };
     auto range2{ m_kernels.equal_range(2) };
@@ -158,8 +261,79 @@ namespace we
     for (auto it{ range1.first }; it != range1.second; it++) randomize_kernel(it->second, generator);
     for (auto it{ range2.first }; it != range2.second; it++) randomize_kernel(it->second, generator);
 
-    rebuild_kernel();
-    rebuild_shader();
+    mark_edit();
+  }
+
+  void system::verify()
+  {
+    // Compare against the current kernels, not the programs still linking for them
+    finish_shader(true);
+
+    engine engine{ m_system_width, m_system_height, m_generator_width, m_generator_height, 1 };
+
+    static const std::array<std::uint32_t, 3> s_channels{ GL_RED, GL_GREEN, GL_BLUE };
+
+    std::uint32_t cells{ m_system_width * m_system_height };
+
+    std::vector<std::float_t> state{};
+    std::vector<std::float_t> generator{};
+
+    state.resize(cells * 3);
+    generator.resize(m_generator_width * m_generator_height * 4);
+
+    // Read one channel at a time straight into the engine's planar layout
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbos[e_fb_front]);
+    for (std::uint32_t c{}; c < 3; c++) glReadPixels(0, 0, m_system_width, m_system_height, s_channels[c], GL_FLOAT, &state[c * cells]);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbos[e_fb_gen]);
+    glReadPixels(0, 0, m_generator_width, m_generator_height, GL_RGBA, GL_FLOAT, &generator[0]);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    engine.set_kernels(m_kernels);
+    engine.set_lowrank(m_lowrank);
+    engine.set_sparse(m_sparse);
+    engine.set_growth_table(m_growth_table);
+    engine.set_storage((m_storage == texture::e_format_half) ? engine::e_storage_half : (m_storage == texture::e_format_float) ? engine::e_storage_float : engine::e_storage_unorm8);
+    engine.set_planes(state);
+    engine.set_generator(generator);
+    engine.step();
+
+    swap();
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbos[e_fb_front]);
+    for (std::uint32_t c{}; c < 3; c++) glReadPixels(0, 0, m_system_width, m_system_height, s_channels[c], GL_FLOAT, &state[c * cells]);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    std::float_t error{};
+    std::uint32_t mismatches{};
+
+    std::vector<std::float_t> values{};
+
+    engine.get_planes(values);
+
+    for (std::uint32_t i{}; i < state.size(); i++)
+    {
+      std::float_t e{ std::fabs(values[i] - state[i]) };
+
+      if (!(e <= engine::s_tolerance)) mismatches++;
+      if (e > error) error = e;
+    }
+
+    std::printf("Verify max error %.7f, %u of %zu values above tolerance\n", error, mismatches, state.size());
+  }
+
+  void system::create_kernels(std::unordered_multimap<std::uint32_t, kernel>& kernels)
+  {
+    kernels.emplace(0, kernel{ "r0", 0, 1.0f, 22, 95.546f, 101.467f, 4, growth{ 14.744f, 1.361f, 9.773f, 4 } });
+    kernels.emplace(0, kernel{ "r1", 0, 1.0f, 14, 27.401f, 201.791f, 10, growth{ 7.503f, 1.056f, 5.234f, 8 } });
+    kernels.emplace(0, kernel{ "r2", 0, 1.0f, 26, 72.666f, 355.859f, 3, growth{ 14.210f, 0.311f, 2.862f, 1 } });
+
+    kernels.emplace(1, kernel{ "g0", 1, 1.0f, 13, 89.537f, 310.026f, 4, growth{ 19.295f, 1.32f, 6.475f, 13 } });
+    kernels.emplace(1, kernel{ "g1", 1, 1.0f, 26, 33.693f, 199.018f, 2, growth{ 17.667f, 1.678f, 2.314f, 20 } });
+    kernels.emplace(1, kernel{ "g2", 1, 1.0f, 27, 85.988f, 408.609f, 8, growth{ 18.425f, 0.01f, 8.164f, 14 } });
+
+    kernels.emplace(2, kernel{ "b0", 2, 1.0f, 17, 39.609f, 383.556f, 3, growth{ 15.637f, 0.933f, 2.713f, 2 } });
+    kernels.emplace(2, kernel{ "b1", 2, 1.0f, 7, 74.299f, 70.204f, 7, growth{ 14.115f, 1.752f, 5.816f, 10 } });
+    kernels.emplace(2, kernel{ "b2", 2, 1.0f, 13, 63.958f, 495.396f, 13, growth{ 2.907f, 1.915f, 2.45f, 1 } });
   }
 
   void system::rebuild_kernel()
@@ -173,9 +347,200 @@ namespace we
     for (auto it{ range2.first }; it != range2.second; it++) compute_kernel(it->second);
   }
 
+  void system::rebuild_edited()
+  {
+    bool edited{};
+    bool resized{};
+
+    m_generating = false;
+
+    for (auto& [channel, kernel] : m_kernels)
+    {
+      slot& slot{ *m_slots[kernel.slot] };
+
+      // Finished generations are only taken here, between two steps
+      if (slot.state.load(std::memory_order_acquire) == e_slot_ready)
+      {
+        bool sized{ slot.work.size != kernel.size };
+
+        copy_shape(slot.work, kernel);
+
+        std::swap(kernel.values, slot.work.values);
+        std::swap(kernel.rows, slot.work.rows);
+        std::swap(kernel.cols, slot.work.cols);
+        std::swap(kernel.taps, slot.work.taps);
+
+        kernel.rank = slot.work.rank;
+        kernel.rank_error = slot.work.rank_error;
+        kernel.density = slot.work.density;
+
+        // Low rank was turned on while the task ran without it
+        if (m_lowrank && !slot.factored) lowrank::factor(kernel, m_lowrank_error);
+
+        if (sized)
+        {
+          texture::destroy(kernel.texture);
+          texture::create_from_plane(kernel.texture, kernel.size, kernel.size, kernel.values);
+
+          resized = true;
+        }
+        else
+        {
+          // Same length, so the weights are overwritten where they are and nothing else moves
+          texture::update_from_plane(kernel.texture, kernel.size, kernel.size, kernel.values);
+
+          // Programs still linking take the whole buffer with them in bind_weights
+          if (!m_build.pending) buffer::update_storage_range(m_buffers[e_buf_weights], kernel.weight_offset * sizeof(std::float_t), kernel.values);
+        }
+
+        slot.state.store(e_slot_idle, std::memory_order_relaxed);
+
+        edited = true;
+      }
+
+      // One generation per kernel at a time, edits made meanwhile are folded into the next one
+      if (slot.dirty && slot.state.load(std::memory_order_relaxed) == e_slot_idle)
+      {
+        copy_shape(slot.edit, slot.work);
+
+        slot.dirty = false;
+        slot.factored = m_lowrank;
+        slot.state.store(e_slot_busy, std::memory_order_relaxed);
+
+        // Factoring costs far more than the rest of an edit, and only the low rank path reads it
+        get_tasks().post([&slot, error{ m_lowrank_error }, cutoff{ m_sparse_cutoff }]
+        {
+          compute_kernel(slot.work);
+
+          if (slot.factored) lowrank::factor(slot.work, error);
+
+          sparse::gather(slot.work, cutoff);
+
+          slot.state.store(e_slot_ready, std::memory_order_release);
+        });
+      }
+
+      if (slot.state.load(std::memory_order_relaxed) != e_slot_idle) m_generating = true;
+    }
+
+    // Copies such as grid layers were taken when the edit was made, before the values landed
+    if (edited) m_revision++;
+
+    // A new size moves the offsets of every later kernel
+    if (resized) rebuild_weights();
+
+    // Dense weights are read from the buffer, only baked factors, taps and tiles need a new program
+    if (edited && (m_lowrank || m_sparse || is_tile_stale())) rebuild_shader();
+
+    // Otherwise the new offsets go to the current programs right away
+    if (resized && !m_build.pending) bind_weights();
+  }
+
+  void system::rebuild_weights()
+  {
+    std::uint32_t offset{};
+
+    auto range0{ m_kernels.equal_range(0) };
+    auto range1{ m_kernels.equal_range(1) };
+    auto range2{ m_kernels.equal_range(2) };
+
+    for (auto it{ range0.first }; it != range0.second; it++) { it->second.weight_offset = offset; offset += static_cast<std::uint32_t>(it->second.values.size()); }
+    for (auto it{ range1.first }; it != range1.second; it++) { it->second.weight_offset = offset; offset += static_cast<std::uint32_t>(it->second.values.size()); }
+    for (auto it{ range2.first }; it != range2.second; it++) { it->second.weight_offset = offset; offset += static_cast<std::uint32_t>(it->second.values.size()); }
+
+    // Union footprint of the fused loop in texel offsets, a kernel of size k covers [-k / 2, k - k / 2)
+    std::uint32_t before{};
+    std::uint32_t after{};
+
+    for (const auto& [channel, kernel] : m_kernels)
+    {
+      if (!is_fused(kernel)) continue;
+
+      before = std::max(before, kernel.size / 2);
+      after = std::max(after, kernel.size - kernel.size / 2);
+    }
+
+    m_fused_before = before;
+    m_fused_size = before + after;
+  }
+
+  void system::bind_weights()
+  {
+    std::vector<std::float_t> weights{};
+
+    auto range0{ m_kernels.equal_range(0) };
+    auto range1{ m_kernels.equal_range(1) };
+    auto range2{ m_kernels.equal_range(2) };
+
+    // Same order as rebuild_weights, so every kernel lands at its weight_offset
+    for (auto it{ range0.first }; it != range0.second; it++) weights.insert(weights.end(), it->second.values.begin(), it->second.values.end());
+    for (auto it{ range1.first }; it != range1.second; it++) weights.insert(weights.end(), it->second.values.begin(), it->second.values.end());
+    for (auto it{ range2.first }; it != range2.second; it++) weights.insert(weights.end(), it->second.values.begin(), it->second.values.end());
+
+    if (m_buffers[e_buf_weights])
+    {
+      buffer::update_storage(m_buffers[e_buf_weights], weights);
+    }
+    else
+    {
+      buffer::create_storage(m_buffers[e_buf_weights], weights);
+    }
+
+    m_bound.sizes.resize(m_slots.size());
+    m_bound.offsets.resize(m_slots.size());
+
+    for (const auto& [channel, kernel] : m_kernels)
+    {
+      m_bound.sizes[kernel.slot] = kernel.size;
+      m_bound.offsets[kernel.slot] = kernel.weight_offset;
+    }
+
+    m_bound.fused_before = m_fused_before;
+    m_bound.fused_size = m_fused_size;
+    m_bound.growth_table = m_growth_table;
+  }
+
+  void system::rebuild_factors()
+  {
+    auto range0{ m_kernels.equal_range(0) };
+    auto range1{ m_kernels.equal_range(1) };
+    auto range2{ m_kernels.equal_range(2) };
+
+    for (auto it{ range0.first }; it != range0.second; it++) lowrank::factor(it->second, m_lowrank_error);
+    for (auto it{ range1.first }; it != range1.second; it++) lowrank::factor(it->second, m_lowrank_error);
+    for (auto it{ range2.first }; it != range2.second; it++) lowrank::factor(it->second, m_lowrank_error);
+  }
+
+  void system::rebuild_taps()
+  {
+    auto range0{ m_kernels.equal_range(0) };
+    auto range1{ m_kernels.equal_range(1) };
+    auto range2{ m_kernels.equal_range(2) };
+
+    for (auto it{ range0.first }; it != range0.second; it++) sparse::gather(it->second, m_sparse_cutoff);
+    for (auto it{ range1.first }; it != range1.second; it++) sparse::gather(it->second, m_sparse_cutoff);
+    for (auto it{ range2.first }; it != range2.second; it++) sparse::gather(it->second, m_sparse_cutoff);
+  }
+
   void system::rebuild_shader()
   {
-    shader::destroy(m_programs[e_prog_conv]);
+    // A newer build replaces one still linking
+    for (shader::job& job : m_build.jobs) shader::cancel(job);
+
+    std::uint32_t term{};
+    {
+      auto range0{ m_kernels.equal_range(0) };
+      auto range1{ m_kernels.equal_range(1) };
+      auto range2{ m_kernels.equal_range(2) };
+
+      for (auto it{ range0.first }; it != range0.second; it++) assign_terms(it->second, term);
+      for (auto it{ range1.first }; it != range1.second; it++) assign_terms(it->second, term);
+      for (auto it{ range2.first }; it != range2.second; it++) assign_terms(it->second, term);
+    }
+
+    m_build.term_groups = (term + 3) / 4;
+
+    rebuild_terms();
 
     std::stringstream shader{};
 
@@ -183,9 +548,19 @@ namespace we
     shader << "layout (location = 0) in Forward\n{\n  vec4 uv;\n} i_fwd;\n\n";
     shader << "layout (location = 0) out vec4 o_color;\n\n";
     shader << "layout (location = 0) uniform sampler2D u_texture;\n";
-    shader << "layout (location = 1) uniform vec2 u_texture_size;\n\n";
+    shader << "layout (location = 1) uniform vec2 u_texture_size;\n";
+    shader << "layout (location = 2) uniform int u_fused_before;\n";
+    shader << "layout (location = 3) uniform int u_fused_size;\n\n";
+
+    // Dense weights of every kernel back to back, placed by u_<name>_offset
+    shader << "layout (std430, binding = 0) readonly buffer Weights\n{\n  float u_weights[];\n};\n\n";
+
+    if (m_build.term_groups)
+    {
+      shader << "layout (binding = 1) uniform sampler2D u_terms;\n\n";
+    }
 
-    std::uint32_t location{ 2 };
+    std::uint32_t location{ 4 };
     {
       auto range0{ m_kernels.equal_range(0) };
       auto range1{ m_kernels.equal_range(1) };
@@ -206,6 +581,8 @@ namespace we
       for (auto it{ range2.first }; it != range2.second; it++) stringify_kernel(it->second, shader);
     }
 
+    stringify_growth_shape(shader);
+
     {
       auto range0{ m_kernels.equal_range(0) };
       auto range1{ m_kernels.equal_range(1) };
@@ -220,6 +597,12 @@ namespace we
     shader << "  float fx = 1.0 / u_texture_size.x;\n";
     shader << "  float fy = 1.0 / u_texture_size.y;\n\n";
 
+    if (m_build.term_groups)
+    {
+      shader << "  ivec2 p = ivec2(gl_FragCoord.xy);\n";
+      shader << "  ivec2 size = ivec2(u_texture_size);\n\n";
+    }
+
     {
       auto range0{ m_kernels.equal_range(0) };
       auto range1{ m_kernels.equal_range(1) };
@@ -232,6 +615,8 @@ namespace we
 
     shader << "\n";
 
+    stringify_fused_convolution(shader);
+
     {
       auto range0{ m_kernels.equal_range(0) };
       auto range1{ m_kernels.equal_range(1) };
@@ -254,203 +639,731 @@ namespace we
       for (auto it{ range2.first }; it != range2.second; it++) stringify_results(it->second, shader);
     }
 
-    //shader << "  float rm = c.r + r0_c + r1_c + r2_c + g0_c + g1_c + g2_c + b0_c + b1_c + b2_c;\n";
-    //shader << "  float gm = c.g + r0_c + r1_c + r2_c + g0_c + g1_c + g2_c + b0_c + b1_c + b2_c;\n";
-    //shader << "  float bm = c.b + r0_c + r1_c + r2_c + g0_c + g1_c + g2_c + b0_c + b1_c + b2_c;\n\n";
-
-    //shader << "  float rm = c.r + g0_c + g1_c + g2_c + b0_c + b1_c + b2_c;\n";
-    //shader << "  float gm = c.g + r0_c + r1_c + r2_c + b0_c + b1_c + b2_c;\n";
-    //shader << "  float bm = c.b + r0_c + r1_c + r2_c + g0_c + g1_c + g2_c;\n\n";
-
-    //shader << "  float rm = c.r + g0_c + g1_c + g2_c;\n";
-    //shader << "  float gm = c.g + b0_c + b1_c + b2_c;\n";
-    //shader << "  float bm = c.b + r0_c + r1_c + r2_c;\n\n";
-
-    shader << "  float rm = c.r + r0_c + g1_c + b2_c;\n";
-    shader << "  float gm = c.g + r1_c + g2_c + b0_c;\n";
-    shader << "  float bm = c.b + r2_c + g0_c + b1_c;\n\n";
-
-    shader << "  float r = clamp(rm, 0.0, 1.0);\n";
-    shader << "  float g = clamp(gm, 0.0, 1.0);\n";
-    shader << "  float b = clamp(bm, 0.0, 1.0);\n\n";
+    stringify_mixing(shader);
 
     shader << "  o_color = vec4(r, g, b, 1.0);\n";
     shader << "}";
 
-    std::printf(shader.str().c_str());
-
-    shader::create(m_programs[e_prog_conv], shader::s_rect_vertex_source, shader.str());
-  }
+    std::printf("%s\n", shader.str().c_str());
 
-  void system::rebuild_preview()
-  {
-    auto range0{ m_kernels.equal_range(0) };
-    auto range1{ m_kernels.equal_range(1) };
-    auto range2{ m_kernels.equal_range(2) };
+    shader::submit(m_build.jobs[e_prog_conv], shader::s_rect_vertex_source, shader.str());
 
-    for (auto it{ range0.first }; it != range0.second; it++) texture::create_from_values(it->second.texture, it->second.size, it->second.size, it->second.values);
-    for (auto it{ range1.first }; it != range1.second; it++) texture::create_from_values(it->second.texture, it->second.size, it->second.size, it->second.values);
-    for (auto it{ range2.first }; it != range2.second; it++) texture::create_from_values(it->second.texture, it->second.size, it->second.size, it->second.values);
-  }
+    rebuild_compute();
 
-  void system::update_uniforms(kernel& kernel)
-  {
-    glUniform1f(glGetUniformLocation(m_programs[e_prog_conv], std::format("u_{}_time", kernel.name).c_str()), kernel.time);
-    glUniform1f(glGetUniformLocation(m_programs[e_prog_conv], std::format("u_{}_growth_height", kernel.name).c_str()), kernel.growth.height);
-    glUniform1f(glGetUniformLocation(m_programs[e_prog_conv], std::format("u_{}_growth_offset", kernel.name).c_str()), kernel.growth.offset);
-    glUniform1f(glGetUniformLocation(m_programs[e_prog_conv], std::format("u_{}_growth_smoothness", kernel.name).c_str()), kernel.growth.smoothness);
-    glUniform1i(glGetUniformLocation(m_programs[e_prog_conv], std::format("u_{}_growth_sharpness", kernel.name).c_str()), kernel.growth.sharpness);
+    m_build.pending = true;
   }
 
-  void system::ui_kernel(kernel& kernel)
+  void system::finish_shader(bool wait)
   {
-    ImGui::PushID(&kernel);
-    if (ImGui::CollapsingHeader(kernel.name.c_str()))
-    {
-      ImGui::PushItemWidth(ImGui::GetWindowContentRegionWidth());
+    if (!m_build.pending) return;
 
-      ImGui::DragFloat("##Time", &kernel.time, 0.01f, 0.0f, 1.0f, "Time %.3f");
+    // Every job is asked each time, so none of them waits for another to be polled first
+    bool linked{ true };
 
-      ImGui::Separator();
+    for (shader::job& job : m_build.jobs) if (job.program && !shader::poll(job, wait)) linked = false;
 
-      if (ImGui::DragInt("##Kernel Size", reinterpret_cast<std::int32_t*>(&kernel.size), 1.0f, 1, 50, "Kernel Size %d")) m_dirty = 1;
-      if (ImGui::DragFloat("##Kernel Offset", &kernel.offset, 0.1f, 0.0f, 0.0f, "Kernel Offset %.3f")) m_dirty = 1;
-      if (ImGui::DragFloat("##Kernel Distance", &kernel.distance, 0.1f, 0.0f, 0.0f, "Kernel Distance %.3f")) m_dirty = 1;
-      if (ImGui::DragInt("##Kernel Sharpness", reinterpret_cast<std::int32_t*>(&kernel.sharpness), 1.0f, 0, 100, "Kernel Sharpness %d")) m_dirty = 1;
+    if (!linked) return;
 
-      if (m_dirty)
-      {
-        texture::destroy(kernel.texture);
+    // A build that failed to link is dropped, the current programs keep stepping with their inputs
+    bool failed{};
 
-        compute_kernel(kernel);
+    for (const shader::job& job : m_build.jobs) failed |= job.failed;
 
-        texture::create_from_values(kernel.texture, kernel.size, kernel.size, kernel.values);
-      }
+    if (failed)
+    {
+      for (shader::job& job : m_build.jobs) shader::cancel(job);
 
-      ImGui::Image(reinterpret_cast<void*>(static_cast<std::uint64_t>(kernel.texture)), { 256.0f, 256.0f });
+      m_build.pending = false;
 
-      ImGui::DragFloat("GrowthHeight", &kernel.growth.height, 0.05f, 0.0f, 50.0f, "Growth Height %.3f");
-      ImGui::DragFloat("GrowthOffset", &kernel.growth.offset, 1.0f, 0.0f, 1000.0f, "Growth Offset %.3f");
-      ImGui::DragFloat("GrowthSmoothness", &kernel.growth.smoothness, 0.1f, 0.0f, 100.0f, "Growth Smoothness %.3f");
-      ImGui::DragInt("GrowthSharpness", reinterpret_cast<std::int32_t*>(&kernel.growth.sharpness), 1.0f, 0, 100, "Growth Sharpness %d");
+      return;
+    }
 
-      static std::array<std::float_t, 64> growth{};
-      for (int32_t i = -10; i < 54; i++)
-      {
-        growth[i + 10] = bump(static_cast<std::float_t>(i), kernel.growth.height, kernel.growth.offset, kernel.growth.smoothness, kernel.growth.sharpness);
-      }
-      ImGui::PlotLines("", &growth[0], 64, 0, "Growth", -2.0f, 2.0f, { 256.0f, 100.0f });
+    // Programs of one build bake the same terms and footprint, so they replace the current ones together
+    for (std::uint32_t i{}; i < m_programs.size(); i++)
+    {
+      shader::destroy(m_programs[i]);
 
-      ImGui::PopItemWidth();
+      m_programs[i] = m_build.jobs[i].program;
+      m_build.jobs[i] = {};
     }
-    ImGui::PopID();
-  }
-
-  void system::compute_kernel(kernel& kernel)
-  {
-    kernel.values.resize(kernel.size * kernel.size * 4);
 
-    for (std::uint32_t i{}; i < kernel.size; i++)
+    if (m_term_groups != m_build.term_groups)
     {
-      for (std::uint32_t j{}; j < kernel.size; j++)
+      framebuffer::destroy(m_fbos[e_fb_terms]);
+      texture::destroy(m_textures[e_tex_terms]);
+
+      m_fbos[e_fb_terms] = 0;
+      m_textures[e_tex_terms] = 0;
+
+      m_term_groups = m_build.term_groups;
+
+      // Terms are signed and unbounded, so they need a float target stacked as groups of four
+      if (m_term_groups)
       {
-        std::uint32_t idx{ (i + j * kernel.size) * 4 };
-
-        std::float_t h{ static_cast<std::float_t>(kernel.size) / 2.0f };
-        std::float_t x{ static_cast<std::float_t>(i) - (h - 0.5f) };
-        std::float_t y{ static_cast<std::float_t>(j) - (h - 0.5f) };
-        std::float_t l{ std::sqrtf(x * x + y * y) };
-        std::float_t m{ l + kernel.offset };
-        std::float_t s{ std::sinf((m * m) / kernel.distance) };
-        std::float_t v{ std::powf(s, static_cast<std::float_t>(kernel.sharpness)) };
-
-        if (v < 0.0f) v = 0.0f;
-        if (v > 1.0f) v = 1.0f;
-
-        if (std::fetestexcept(FE_DIVBYZERO)) v = 0.0f;
-        if (std::fetestexcept(FE_INVALID)) v = 0.0f;
-        if (std::fetestexcept(FE_OVERFLOW)) v = 0.0f;
-        if (std::fetestexcept(FE_UNDERFLOW)) v = 0.0f;
-
-        std::feclearexcept(FE_ALL_EXCEPT);
-
-        kernel.values[idx + 0] = v;
-        kernel.values[idx + 1] = v;
-        kernel.values[idx + 2] = v;
-        kernel.values[idx + 3] = 1.0f;
+        texture::create_float(m_textures[e_tex_terms], m_system_width, m_system_height * m_term_groups);
+        framebuffer::create(m_fbos[e_fb_terms], m_textures[e_tex_terms]);
       }
     }
+
+    m_compute_group = m_build.compute_group;
+    m_compute_before = m_build.compute_before;
+    m_compute_size = m_build.compute_size;
+
+    m_build.pending = false;
+
+    // Sizes, offsets and weights the old programs kept stepping with are replaced along with them
+    bind_weights();
+    rebuild_locations();
   }
 
-  void system::randomize_kernel(kernel& kernel, std::mt19937& generator)
+  void system::rebuild_locations()
   {
-    std::uniform_int_distribution<std::uint32_t> kernel_dist{ 3, 30 };
-    std::uniform_real_distribution<std::float_t> kernel_offset_dist{ 0.0f, 100.0f };
-    std::uniform_real_distribution<std::float_t> kernel_distance_dist{ 50.0f, 500.0f };
-    std::uniform_int_distribution<std::uint32_t> kernel_sharpness_dist{ 1, 20 };
-    
-    kernel.size = kernel_dist(generator);
-    kernel.offset = kernel_offset_dist(generator);
-    kernel.distance = kernel_distance_dist(generator);
-    kernel.sharpness = kernel_sharpness_dist(generator);
+    std::uint32_t program{ m_programs[m_compute_group ? e_prog_compute : e_prog_conv] };
 
-    std::uniform_real_distribution<std::float_t> growth_height_dist{ 0.0f, 20.0f };
-    std::uniform_real_distribution<std::float_t> growth_offset_dist{ 0.0f, 2.0f };
-    std::uniform_real_distribution<std::float_t> growth_smoothness_dist{ 0.0f, 10.0f };
-    std::uniform_int_distribution<std::uint32_t> growth_sharpness_dist{ 1, 20 };
-    
-    kernel.growth.height = growth_height_dist(generator);
-    kernel.growth.offset = growth_offset_dist(generator);
-    kernel.growth.smoothness = growth_smoothness_dist(generator);
-    kernel.growth.sharpness = growth_sharpness_dist(generator);
+    // Looked up here so swap never formats a name or asks the driver
+    m_texture_size_location = glGetUniformLocation(program, "u_texture_size");
+    m_fused_before_location = glGetUniformLocation(program, "u_fused_before");
+    m_fused_size_location = glGetUniformLocation(program, "u_fused_size");
+
+    auto range0{ m_kernels.equal_range(0) };
+    auto range1{ m_kernels.equal_range(1) };
+    auto range2{ m_kernels.equal_range(2) };
+
+    for (auto it{ range0.first }; it != range0.second; it++) locate_uniforms(it->second);
+    for (auto it{ range1.first }; it != range1.second; it++) locate_uniforms(it->second);
+    for (auto it{ range2.first }; it != range2.second; it++) locate_uniforms(it->second);
   }
 
-  void system::stringify_uniforms(const kernel& kernel, std::stringstream& shader, std::uint32_t& location)
+  void system::rebuild_terms()
+  {
+    if (!m_build.term_groups) return;
+
+    std::stringstream shader{};
+
+    shader << "#version 460 core\n\n";
+    shader << "layout (location = 0) in Forward\n{\n  vec4 uv;\n} i_fwd;\n\n";
+    shader << "layout (location = 0) out vec4 o_color;\n\n";
+    shader << "layout (location = 0) uniform sampler2D u_texture;\n\n";
+
+    {
+      auto range0{ m_kernels.equal_range(0) };
+      auto range1{ m_kernels.equal_range(1) };
+      auto range2{ m_kernels.equal_range(2) };
+
+      for (auto it{ range0.first }; it != range0.second; it++) stringify_rows(it->second, shader);
+      for (auto it{ range1.first }; it != range1.second; it++) stringify_rows(it->second, shader);
+      for (auto it{ range2.first }; it != range2.second; it++) stringify_rows(it->second, shader);
+    }
+
+    shader << "void main()\n{\n";
+    shader << "  ivec2 size = textureSize(u_texture, 0);\n";
+    shader << "  ivec2 p = ivec2(gl_FragCoord.xy);\n";
+    shader << "  int y = p.y % size.y;\n\n";
+    shader << "  vec4 t = vec4(0.0);\n\n";
+    shader << "  switch (p.y / size.y)\n  {\n";
+
+    for (std::uint32_t group{}; group < m_build.term_groups; group++)
+    {
+      shader << "    case " << group << ":\n";
+
+      auto range0{ m_kernels.equal_range(0) };
+      auto range1{ m_kernels.equal_range(1) };
+      auto range2{ m_kernels.equal_range(2) };
+
+      for (auto it{ range0.first }; it != range0.second; it++) stringify_terms(it->second, shader, group);
+      for (auto it{ range1.first }; it != range1.second; it++) stringify_terms(it->second, shader, group);
+      for (auto it{ range2.first }; it != range2.second; it++) stringify_terms(it->second, shader, group);
+
+      shader << "      break;\n";
+    }
+
+    shader << "  }\n\n";
+    shader << "  o_color = t;\n";
+    shader << "}";
+
+    shader::submit(m_build.jobs[e_prog_terms], shader::s_rect_vertex_source, shader.str());
+  }
+
+  void system::rebuild_compute()
+  {
+    m_build.compute_group = 0;
+    m_build.compute_before = 0;
+    m_build.compute_size = 0;
+
+    if (!is_compute()) return;
+
+    std::int32_t shared_size{};
+    glGetIntegerv(GL_MAX_COMPUTE_SHARED_MEMORY_SIZE, &shared_size);
+
+    // Texels the fused loop reaches past the edge of the group
+    std::uint32_t halo{ std::max(m_fused_size, 1u) - 1 };
+
+    // Largest square group whose tile and halo fit in shared memory, else stay on the fragment pass
+    std::uint32_t group{ 16 };
+    while (group > 4 && (group + halo) * (group + halo) * 3 * sizeof(std::float_t) > static_cast<std::uint32_t>(shared_size)) group /= 2;
+
+    std::uint32_t tile{ group + halo };
+
+    if (tile * tile * 3 * sizeof(std::float_t) > static_cast<std::uint32_t>(shared_size)) return;
+
+    std::stringstream shader{};
+
+    shader << "#version 460 core\n\n";
+    shader << "layout (local_size_x = " << group << ", local_size_y = " << group << ") in;\n\n";
+    shader << "layout (location = 0) uniform sampler2D u_texture;\n";
+    shader << "layout (location = 1) uniform vec2 u_texture_size;\n";
+    shader << "layout (binding = 2) uniform sampler2D u_generator;\n";
+    shader << "layout (binding = 0, " << ((m_storage == texture::e_format_half) ? "rgba16f" : (m_storage == texture::e_format_float) ? "rgba32f" : "rgba8") << ") writeonly uniform image2D u_output;\n\n";
+
+    shader << "layout (std430, binding = 0) readonly buffer Weights\n{\n  float u_weights[];\n};\n\n";
+
+    // Footprint is baked since it sizes the tile
+    shader << "const int c_group = " << group << ";\n";
+    shader << "const int c_before = " << m_fused_before << ";\n";
+    shader << "const int c_size = " << m_fused_size << ";\n";
+    shader << "const int c_tile = " << tile << ";\n\n";
+
+    // Planar so the tile costs 12 bytes a texel whatever the padding of a shared vec3
+    shader << "shared float s_r[c_tile * c_tile];\n";
+    shader << "shared float s_g[c_tile * c_tile];\n";
+    shader << "shared float s_b[c_tile * c_tile];\n\n";
+
+    std::uint32_t location{ 4 };
+    {
+      auto range0{ m_kernels.equal_range(0) };
+      auto range1{ m_kernels.equal_range(1) };
+      auto range2{ m_kernels.equal_range(2) };
+
+      for (auto it{ range0.first }; it != range0.second; it++) stringify_uniforms(it->second, shader, location);
+      for (auto it{ range1.first }; it != range1.second; it++) stringify_uniforms(it->second, shader, location);
+      for (auto it{ range2.first }; it != range2.second; it++) stringify_uniforms(it->second, shader, location);
+    }
+
+    stringify_growth_shape(shader);
+
+    {
+      auto range0{ m_kernels.equal_range(0) };
+      auto range1{ m_kernels.equal_range(1) };
+      auto range2{ m_kernels.equal_range(2) };
+
+      for (auto it{ range0.first }; it != range0.second; it++) stringify_growth(it->second, shader);
+      for (auto it{ range1.first }; it != range1.second; it++) stringify_growth(it->second, shader);
+      for (auto it{ range2.first }; it != range2.second; it++) stringify_growth(it->second, shader);
+    }
+
+    shader << "void main()\n{\n";
+    shader << "  ivec2 size = ivec2(u_texture_size);\n";
+    shader << "  ivec2 origin = ivec2(gl_WorkGroupID.xy) * c_group - c_before;\n\n";
+
+    // Every texel of the tile is fetched once and shared by all kernels of all invocations in the group
+    shader << "  for (int k = int(gl_LocalInvocationIndex); k < c_tile * c_tile; k += c_group * c_group)\n  {\n";
+    shader << "    ivec2 t = (origin + ivec2(k % c_tile, k / c_tile) + size) % size;\n";
+    shader << "    vec3 s = texelFetch(u_texture, t, 0).rgb;\n\n";
+    shader << "    s_r[k] = s.r;\n";
+    shader << "    s_g[k] = s.g;\n";
+    shader << "    s_b[k] = s.b;\n";
+    shader << "  }\n\n";
+
+    shader << "  memoryBarrierShared();\n";
+    shader << "  barrier();\n\n";
+
+    shader << "  ivec2 p = ivec2(gl_GlobalInvocationID.xy);\n";
+    shader << "  ivec2 l = ivec2(gl_LocalInvocationID.xy);\n\n";
+
+    shader << "  if (any(greaterThanEqual(p, size))) return;\n\n";
+
+    // Stands in for the generator blit of the fragment pass
+    shader << "  ivec2 q = p - size / 2;\n\n";
+    shader << "  if (all(greaterThanEqual(q, ivec2(0))) && all(lessThan(q, textureSize(u_generator, 0))))\n  {\n";
+    shader << "    imageStore(u_output, p, texelFetch(u_generator, q, 0));\n";
+    shader << "    return;\n";
+    shader << "  }\n\n";
+
+    std::vector<const kernel*> kernels{};
+    {
+      auto range0{ m_kernels.equal_range(0) };
+      auto range1{ m_kernels.equal_range(1) };
+      auto range2{ m_kernels.equal_range(2) };
+
+      for (auto it{ range0.first }; it != range0.second; it++) kernels.emplace_back(&it->second);
+      for (auto it{ range1.first }; it != range1.second; it++) kernels.emplace_back(&it->second);
+      for (auto it{ range2.first }; it != range2.second; it++) kernels.emplace_back(&it->second);
+    }
+
+    for (const kernel* kernel : kernels)
+    {
+      shader << "  float " << kernel->name << "_sum = 0.0;\n";
+    }
+
+    shader << "\n";
+
+    for (const kernel* kernel : kernels)
+    {
+      shader << "  int " << kernel->name << "_o = c_before - u_" << kernel->name << "_size / 2;\n";
+    }
+
+    // Same i, j order and weight indexing as stringify_fused_convolution
+    shader << "\n";
+    shader << "  for (int i = 0; i < c_size; i++)\n  {\n";
+    shader << "    for (int j = 0; j < c_size; j++)\n    {\n";
+    shader << "      int k = (l.x + i) + (l.y + j) * c_tile;\n";
+    shader << "      vec3 s = vec3(s_r[k], s_g[k], s_b[k]);\n\n";
+
+    for (const kernel* kernel : kernels)
+    {
+      std::string o{ kernel->name + "_o" };
+      std::string k{ "u_" + kernel->name + "_size" };
+
+      shader << "      if (uint(i - " << o << ") < uint(" << k << ") && uint(j - " << o << ") < uint(" << k << ")) ";
+      shader << kernel->name << "_sum += u_weights[u_" << kernel->name << "_offset + (i - " << o << ") + (j - " << o << ") * " << k << "] * s." << "rgb"[kernel->channel] << ";\n";
+    }
+
+    shader << "    }\n";
+    shader << "  }\n\n";
+
+    shader << "  int k = (l.x + c_before) + (l.y + c_before) * c_tile;\n";
+    shader << "  vec3 c = vec3(s_r[k], s_g[k], s_b[k]);\n\n";
+
+    for (const kernel* kernel : kernels)
+    {
+      stringify_results(*kernel, shader);
+    }
+
+    stringify_mixing(shader);
+
+    shader << "  imageStore(u_output, p, vec4(r, g, b, 1.0));\n";
+    shader << "}";
+
+    shader::submit_compute(m_build.jobs[e_prog_compute], shader.str());
+
+    m_build.compute_group = group;
+    m_build.compute_before = m_fused_before;
+    m_build.compute_size = m_fused_size;
+  }
+
+  void system::rebuild_preview()
+  {
+    auto range0{ m_kernels.equal_range(0) };
+    auto range1{ m_kernels.equal_range(1) };
+    auto range2{ m_kernels.equal_range(2) };
+
+    for (auto it{ range0.first }; it != range0.second; it++) texture::create_from_plane(it->second.texture, it->second.size, it->second.size, it->second.values);
+    for (auto it{ range1.first }; it != range1.second; it++) texture::create_from_plane(it->second.texture, it->second.size, it->second.size, it->second.values);
+    for (auto it{ range2.first }; it != range2.second; it++) texture::create_from_plane(it->second.texture, it->second.size, it->second.size, it->second.values);
+  }
+
+  void system::rebuild_storage(texture::format storage)
+  {
+    static const std::array<std::uint32_t, 3> s_channels{ GL_RED, GL_GREEN, GL_BLUE };
+
+    std::uint32_t cells{ m_system_width * m_system_height };
+
+    std::vector<std::float_t> state{};
+    std::vector<std::float_t> generator{};
+
+    state.resize(cells * 3);
+    generator.resize(m_generator_width * m_generator_height * 4);
+
+    // Carry the current state over, rounded to the new format on upload
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbos[e_fb_front]);
+    for (std::uint32_t c{}; c < 3; c++) glReadPixels(0, 0, m_system_width, m_system_height, s_channels[c], GL_FLOAT, &state[c * cells]);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbos[e_fb_gen]);
+    glReadPixels(0, 0, m_generator_width, m_generator_height, GL_RGBA, GL_FLOAT, &generator[0]);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    framebuffer::destroy(m_fbos[e_fb_front]);
+    framebuffer::destroy(m_fbos[e_fb_back]);
+    framebuffer::destroy(m_fbos[e_fb_gen]);
+
+    texture::destroy(m_textures[e_tex_front]);
+    texture::destroy(m_textures[e_tex_back]);
+    texture::destroy(m_textures[e_tex_gen]);
+
+    m_storage = storage;
+
+    texture::create_from_planes(m_textures[e_tex_front], m_system_width, m_system_height, state, m_storage);
+    texture::create_fill(m_textures[e_tex_back], m_system_width, m_system_height, 0.0f, m_storage);
+    texture::create_from_values(m_textures[e_tex_gen], m_generator_width, m_generator_height, generator, m_storage);
+
+    framebuffer::create(m_fbos[e_fb_front], m_textures[e_tex_front]);
+    framebuffer::create(m_fbos[e_fb_back], m_textures[e_tex_back]);
+    framebuffer::create(m_fbos[e_fb_gen], m_textures[e_tex_gen]);
+
+    // The compute program declares the image format of the storage, so it cannot keep stepping meanwhile
+    if (m_compute_group)
+    {
+      rebuild_shader();
+      finish_shader(true);
+    }
+  }
+
+  void system::locate_uniforms(kernel& kernel)
+  {
+    std::uint32_t program{ m_programs[m_compute_group ? e_prog_compute : e_prog_conv] };
+
+    kernel.locations.time = glGetUniformLocation(program, std::format("u_{}_time", kernel.name).c_str());
+    kernel.locations.growth_height = glGetUniformLocation(program, std::format("u_{}_growth_height", kernel.name).c_str());
+    kernel.locations.growth_offset = glGetUniformLocation(program, std::format("u_{}_growth_offset", kernel.name).c_str());
+    kernel.locations.growth_smoothness = glGetUniformLocation(program, std::format("u_{}_growth_smoothness", kernel.name).c_str());
+    kernel.locations.growth_sharpness = glGetUniformLocation(program, std::format("u_{}_growth_sharpness", kernel.name).c_str());
+    kernel.locations.size = glGetUniformLocation(program, std::format("u_{}_size", kernel.name).c_str());
+    kernel.locations.offset = glGetUniformLocation(program, std::format("u_{}_offset", kernel.name).c_str());
+  }
+
+  void system::update_uniforms(const kernel& kernel)
+  {
+    glUniform1f(kernel.locations.time, kernel.time);
+    glUniform1f(kernel.locations.growth_height, kernel.growth.height);
+    glUniform1f(kernel.locations.growth_offset, kernel.growth.offset);
+    glUniform1f(kernel.locations.growth_smoothness, kernel.growth.smoothness);
+    glUniform1i(kernel.locations.growth_sharpness, kernel.growth.sharpness);
+    glUniform1i(kernel.locations.size, m_bound.sizes[kernel.slot]);
+    glUniform1i(kernel.locations.offset, m_bound.offsets[kernel.slot]);
+  }
+
+  void system::mark_edit()
+  {
+    if (!m_edit_pending)
+    {
+      m_edit_time = std::chrono::steady_clock::now();
+      m_edit_pending = true;
+    }
+
+    m_revision++;
+  }
+
+  void system::ui_kernel(kernel& kernel)
+  {
+    ImGui::PushID(&kernel);
+    if (ImGui::CollapsingHeader(kernel.name.c_str()))
+    {
+      ImGui::PushItemWidth(ImGui::GetWindowContentRegionWidth());
+
+      // Time and growth are uniforms set every step
+      if (ImGui::DragFloat("##Time", &kernel.time, 0.01f, 0.0f, 1.0f, "Time %.3f")) mark_edit();
+
+      ImGui::Separator();
+
+      // Shape edits go to the slot, the kernel keeps its shape until the new values are generated
+      slot& slot{ *m_slots[kernel.slot] };
+
+      bool edited{};
+
+      if (ImGui::DragInt("##Kernel Size", reinterpret_cast<std::int32_t*>(&slot.edit.size), 1.0f, 1, 50, "Kernel Size %d")) edited = 1;
+      if (ImGui::DragFloat("##Kernel Offset", &slot.edit.offset, 0.1f, 0.0f, 0.0f, "Kernel Offset %.3f")) edited = 1;
+      if (ImGui::DragFloat("##Kernel Distance", &slot.edit.distance, 0.1f, 0.0f, 0.0f, "Kernel Distance %.3f")) edited = 1;
+      if (ImGui::DragInt("##Kernel Sharpness", reinterpret_cast<std::int32_t*>(&slot.edit.sharpness), 1.0f, 0, 100, "Kernel Sharpness %d")) edited = 1;
+
+      if (edited)
+      {
+        slot.dirty = true;
+
+        mark_edit();
+      }
+
+      ImGui::Image(reinterpret_cast<void*>(static_cast<std::uint64_t>(kernel.texture)), { 256.0f, 256.0f });
+
+      ImGui::Text("Rank %u, Error %.5f%s", kernel.rank, kernel.rank_error, is_separable(kernel) ? ", Separable" : "");
+      ImGui::Text("Taps %zu of %u, Density %.1f%%%s", kernel.taps.size(), kernel.size * kernel.size, kernel.density * 100.0f, is_sparse(kernel) ? ", Sparse" : "");
+
+      if (ImGui::DragFloat("GrowthHeight", &kernel.growth.height, 0.05f, 0.0f, 50.0f, "Growth Height %.3f")) mark_edit();
+      if (ImGui::DragFloat("GrowthOffset", &kernel.growth.offset, 1.0f, 0.0f, 1000.0f, "Growth Offset %.3f")) mark_edit();
+      if (ImGui::DragFloat("GrowthSmoothness", &kernel.growth.smoothness, 0.1f, 0.0f, 100.0f, "Growth Smoothness %.3f")) mark_edit();
+      if (ImGui::DragInt("GrowthSharpness", reinterpret_cast<std::int32_t*>(&kernel.growth.sharpness), 1.0f, 0, 100, "Growth Sharpness %d")) mark_edit();
+
+      static std::array<std::float_t, 64> growth{};
+      for (int32_t i = -10; i < 54; i++)
+      {
+        growth[i + 10] = (m_growth_table ? bump_table : bump)(static_cast<std::float_t>(i), kernel.growth.height, kernel.growth.offset, kernel.growth.smoothness, kernel.growth.sharpness);
+      }
+      ImGui::PlotLines("", &growth[0], 64, 0, "Growth", -2.0f, 2.0f, { 256.0f, 100.0f });
+
+      ImGui::PopItemWidth();
+    }
+    ImGui::PopID();
+  }
+
+  void system::compute_kernel(kernel& kernel)
+  {
+    static const simd::isa s_isa{ simd::detect() };
+
+    kernel.values.resize(kernel.size * kernel.size);
+
+    std::float_t h{ static_cast<std::float_t>(kernel.size) / 2.0f };
+    std::float_t x{ 0.0f - (h - 0.5f) };
+
+    // Whole rows at once, see simd::generate_row for how NaN and overflow map to zero
+    for (std::uint32_t j{}; j < kernel.size; j++)
+    {
+      std::float_t y{ static_cast<std::float_t>(j) - (h - 0.5f) };
+
+      simd::generate_row(s_isa, x, y, kernel.offset, kernel.distance, kernel.sharpness, &kernel.values[j * kernel.size], kernel.size);
+    }
+  }
+
+  void system::randomize_kernel(kernel& kernel, std::mt19937& generator)
+  {
+    std::uniform_int_distribution<std::uint32_t> kernel_dist{ 3, 30 };
+    std::uniform_real_distribution<std::float_t> kernel_offset_dist{ 0.0f, 100.0f };
+    std::uniform_real_distribution<std::float_t> kernel_distance_dist{ 50.0f, 500.0f };
+    std::uniform_int_distribution<std::uint32_t> kernel_sharpness_dist{ 1, 20 };
+
+    // Shape is generated in the background like an edit
+    slot& slot{ *m_slots[kernel.slot] };
+    
+    slot.edit.size = kernel_dist(generator);
+    slot.edit.offset = kernel_offset_dist(generator);
+    slot.edit.distance = kernel_distance_dist(generator);
+    slot.edit.sharpness = kernel_sharpness_dist(generator);
+    slot.dirty = true;
+
+    std::uniform_real_distribution<std::float_t> growth_height_dist{ 0.0f, 20.0f };
+    std::uniform_real_distribution<std::float_t> growth_offset_dist{ 0.0f, 2.0f };
+    std::uniform_real_distribution<std::float_t> growth_smoothness_dist{ 0.0f, 10.0f };
+    std::uniform_int_distribution<std::uint32_t> growth_sharpness_dist{ 1, 20 };
+    
+    kernel.growth.height = growth_height_dist(generator);
+    kernel.growth.offset = growth_offset_dist(generator);
+    kernel.growth.smoothness = growth_smoothness_dist(generator);
+    kernel.growth.sharpness = growth_sharpness_dist(generator);
+  }
+
+  void system::copy_shape(const kernel& source, kernel& target)
+  {
+    target.size = source.size;
+    target.offset = source.offset;
+    target.distance = source.distance;
+    target.sharpness = source.sharpness;
+  }
+
+  task_queue& system::get_tasks()
+  {
+    // Shared by every system, kernel generation is short and rarely runs in many at once
+    static task_queue s_tasks{ std::max(std::thread::hardware_concurrency() / 2, 1u) };
+
+    return s_tasks;
+  }
+
+  std::uint32_t system::get_growth_buffer()
+  {
+    // Every row of the table, the same for all systems and kept for the lifetime of the context
+    static std::uint32_t s_buffer{};
+
+    if (!s_buffer) buffer::create_storage(s_buffer, growth_table::get_values());
+
+    return s_buffer;
+  }
+
+  void system::assign_terms(kernel& kernel, std::uint32_t& term)
+  {
+    kernel.term = term;
+
+    if (is_separable(kernel)) term += kernel.rank;
+  }
+
+  bool system::is_separable(const kernel& kernel) const
+  {
+    return m_lowrank && lowrank::is_worthwhile(kernel);
+  }
+
+  bool system::is_sparse(const kernel& kernel) const
+  {
+    return m_sparse && !is_separable(kernel);
+  }
+
+  bool system::is_fused(const kernel& kernel) const
+  {
+    // The compute program only has the fused loop, so it fuses regardless of m_fused
+    return (m_fused || is_compute()) && !is_separable(kernel) && !is_sparse(kernel);
+  }
+
+  bool system::is_compute() const
+  {
+    return m_compute && !m_lowrank && !m_sparse;
+  }
+
+  bool system::is_tile_stale() const
+  {
+    // A build still linking replaces the current programs, so its tile is the one to compare
+    if (m_build.pending) return m_build.compute_group && (m_build.compute_before != m_fused_before || m_build.compute_size != m_fused_size);
+
+    return m_compute_group && (m_compute_before != m_fused_before || m_compute_size != m_fused_size);
+  }
+
+  void system::stringify_uniforms(const kernel& kernel, std::stringstream& shader, std::uint32_t& location)
   {
     shader << "layout (location = " << location++ << ") uniform float u_" << kernel.name << "_time;\n";
     shader << "layout (location = " << location++ << ") uniform float u_" << kernel.name << "_growth_height;\n";
     shader << "layout (location = " << location++ << ") uniform float u_" << kernel.name << "_growth_offset;\n";
     shader << "layout (location = " << location++ << ") uniform float u_" << kernel.name << "_growth_smoothness;\n";
-    shader << "layout (location = " << location++ << ") uniform int u_" << kernel.name << "_growth_sharpness;\n\n";
+    shader << "layout (location = " << location++ << ") uniform int u_" << kernel.name << "_growth_sharpness;\n";
+    shader << "layout (location = " << location++ << ") uniform int u_" << kernel.name << "_size;\n";
+    shader << "layout (location = " << location++ << ") uniform int u_" << kernel.name << "_offset;\n\n";
   }
 
   void system::stringify_kernel(const kernel& kernel, std::stringstream& shader)
   {
-    shader << "const float c_" << kernel.name << "_kernel[" << kernel.size << "][" << kernel.size << "] =\n{\n";
-    for (std::uint32_t i{}; i < kernel.size; i++)
+    if (is_separable(kernel))
     {
-      shader << "  { ";
-      for (std::uint32_t j{}; j < kernel.size; j++)
+      shader << "const float c_" << kernel.name << "_cols[" << kernel.rank << "][" << kernel.size << "] =\n{\n";
+      for (std::uint32_t r{}; r < kernel.rank; r++)
       {
-        std::uint32_t idx{ (i + j * kernel.size) * 4 };
-        shader << std::format("{:.7f}", kernel.values[idx]) << ", ";
+        shader << "  { ";
+        for (std::uint32_t j{}; j < kernel.size; j++)
+        {
+          shader << std::format("{:.7f}", kernel.cols[r * kernel.size + j]) << ", ";
+        }
+        shader << "},\n";
       }
-      shader << "},\n";
+      shader << "};\n\n";
+
+      return;
     }
-    shader << "};\n\n";
+
+    // Sparse taps are baked into the convolution itself, dense weights live in u_weights
+  }
+
+  void system::stringify_growth_shape(std::stringstream& shader)
+  {
+    // Sharpness is an integer, so the power is a few multiplies instead of exp2(n * log2(x))
+    shader << "float growth_power(float x, int n)\n{\n";
+    shader << "  float v = 1.0;\n\n";
+    shader << "  for (; n > 0; n >>= 1)\n  {\n";
+    shader << "    if ((n & 1) != 0) v *= x;\n\n";
+    shader << "    x *= x;\n";
+    shader << "  }\n\n";
+    shader << "  return v;\n";
+    shader << "}\n\n";
+
+    if (!m_growth_table) return;
+
+    // Same steps as growth_table::sample, texels are mixed here since filtering weights are too coarse for the bound
+    shader << "layout (std430, binding = 3) readonly buffer Growth\n{\n  float u_growth[];\n};\n\n";
+    shader << "const int c_growth_size = " << growth_table::get_size() << ";\n";
+    shader << "const int c_growth_max_sharpness = " << growth_table::s_max_sharpness << ";\n\n";
+
+    shader << "float growth_table(float t, int n)\n{\n";
+    shader << "  if (n > c_growth_max_sharpness) return 1.0 / (1.0 + growth_power(t, n));\n\n";
+    shader << "  float p = clamp((1.0 - 1.0 / (1.0 + t)) * float(c_growth_size - 1), 0.0, float(c_growth_size - 1));\n";
+    shader << "  int i = min(int(p), c_growth_size - 2);\n";
+    shader << "  int row = n * c_growth_size + i;\n\n";
+    shader << "  return mix(u_growth[row], u_growth[row + 1], p - float(i));\n";
+    shader << "}\n\n";
   }
 
   void system::stringify_growth(const kernel& kernel, std::stringstream& shader)
   {
     shader << "float " << kernel.name << "_growth(float x)\n{\n";
-    shader << "  return (u_" << kernel.name << "_growth_height / (1.0 + pow(abs((x - u_" << kernel.name << "_growth_offset) / u_" << kernel.name << "_growth_smoothness), u_" << kernel.name << "_growth_sharpness))) - 1.0;\n";
+    shader << "  float t = abs((x - u_" << kernel.name << "_growth_offset) / u_" << kernel.name << "_growth_smoothness);\n";
+
+    if (m_growth_table)
+    {
+      shader << "  return u_" << kernel.name << "_growth_height * growth_table(t, u_" << kernel.name << "_growth_sharpness) - 1.0;\n";
+    }
+    else
+    {
+      shader << "  return (u_" << kernel.name << "_growth_height / (1.0 + growth_power(t, u_" << kernel.name << "_growth_sharpness))) - 1.0;\n";
+    }
+
     shader << "}\n\n";
   }
 
   void system::stringify_convolution(const kernel& kernel, std::stringstream& shader)
   {
-    std::float_t kernel_half_size{ static_cast<std::float_t>(kernel.size) / 2 };
+    if (is_sparse(kernel))
+    {
+      std::float_t kernel_half_size{ static_cast<std::float_t>(kernel.size) / 2 };
+      std::float_t kernel_half_floor{ static_cast<std::float_t>(kernel.size / 2) };
+
+      shader << "  // " << kernel.taps.size() << " of " << kernel.size * kernel.size << " taps\n";
+
+      // Same uv offsets as the dense loop, `float(i) - size / 2.0`
+      for (const tap& tap : kernel.taps)
+      {
+        std::float_t u{ static_cast<std::float_t>(tap.dx) + kernel_half_floor - kernel_half_size };
+        std::float_t v{ static_cast<std::float_t>(tap.dy) + kernel_half_floor - kernel_half_size };
+
+        shader << "  " << kernel.name << "_sum += " << std::format("{:.7f}", tap.weight) << " * texture(u_texture, i_fwd.uv.xy + vec2(fx * " << std::format("{:.1f}", u) << ", fy * " << std::format("{:.1f}", v) << "))." << "rgb"[kernel.channel] << ";\n";
+      }
+
+      shader << "\n";
+
+      return;
+    }
+
+    if (is_separable(kernel))
+    {
+      std::uint32_t first_group{ kernel.term / 4 };
+      std::uint32_t last_group{ (kernel.term + kernel.rank - 1) / 4 };
+
+      shader << "  for (int j = 0; j < " << kernel.size << "; j++)\n  {\n";
+      shader << "    int y = (p.y + j - " << kernel.size / 2 << " + size.y) % size.y;\n";
+
+      for (std::uint32_t group{ first_group }; group <= last_group; group++)
+      {
+        shader << "    vec4 t" << group << " = texelFetch(u_terms, ivec2(p.x, y + " << group << " * size.y), 0);\n";
+      }
+
+      for (std::uint32_t r{}; r < kernel.rank; r++)
+      {
+        std::uint32_t t{ kernel.term + r };
+        shader << "    " << kernel.name << "_sum += c_" << kernel.name << "_cols[" << r << "][j] * t" << t / 4 << "." << "xyzw"[t % 4] << ";\n";
+      }
+
+      shader << "  }\n\n";
+
+      return;
+    }
+
+    // Dense kernels already accumulated by the shared loop
+    if (is_fused(kernel)) return;
+
+    // Size and weights are uniforms, so the program survives kernel edits
+    shader << "  for (int i = 0; i < u_" << kernel.name << "_size; i++)\n  {\n";
+    shader << "    for (int j = 0; j < u_" << kernel.name << "_size; j++)\n    {\n";
+    shader << "      float u = fx * (float(i) - float(u_" << kernel.name << "_size) / 2.0);\n";
+    shader << "      float v = fy * (float(j) - float(u_" << kernel.name << "_size) / 2.0);\n";
+    shader << "      float w = u_weights[u_" << kernel.name << "_offset + i + j * u_" << kernel.name << "_size];\n";
+    shader << "      " << kernel.name << "_sum += w * texture(u_texture, i_fwd.uv.xy + vec2(u, v))." << "rgb"[kernel.channel] << ";\n";
+    shader << "    }\n";
+    shader << "  }\n\n";
+  }
+
+  void system::stringify_fused_convolution(std::stringstream& shader)
+  {
+    std::vector<const kernel*> kernels{};
+    {
+      auto range0{ m_kernels.equal_range(0) };
+      auto range1{ m_kernels.equal_range(1) };
+      auto range2{ m_kernels.equal_range(2) };
+
+      for (auto it{ range0.first }; it != range0.second; it++) if (is_fused(it->second)) kernels.emplace_back(&it->second);
+      for (auto it{ range1.first }; it != range1.second; it++) if (is_fused(it->second)) kernels.emplace_back(&it->second);
+      for (auto it{ range2.first }; it != range2.second; it++) if (is_fused(it->second)) kernels.emplace_back(&it->second);
+    }
 
-    shader << "  for (int i = 0; i < " << kernel.size << "; i++)\n  {\n";
-    shader << "    for (int j = 0; j < " << kernel.size << "; j++)\n    {\n";
-    shader << "      float u = fx * (float(i) - " << kernel_half_size << ");\n";
-    shader << "      float v = fy * (float(j) - " << kernel_half_size << ");\n";
+    if (kernels.empty()) return;
 
-    switch (kernel.channel)
+    // Footprint comes from rebuild_weights through u_fused_before and u_fused_size
+    for (const kernel* kernel : kernels)
     {
-      case 0: shader << "      " << kernel.name << "_sum += c_" << kernel.name << "_kernel[i][j] * texture(u_texture, i_fwd.uv.xy + vec2(u, v)).r;\n"; break;
-      case 1: shader << "      " << kernel.name << "_sum += c_" << kernel.name << "_kernel[i][j] * texture(u_texture, i_fwd.uv.xy + vec2(u, v)).g;\n"; break;
-      case 2: shader << "      " << kernel.name << "_sum += c_" << kernel.name << "_kernel[i][j] * texture(u_texture, i_fwd.uv.xy + vec2(u, v)).b;\n"; break;
+      shader << "  int " << kernel->name << "_o = u_fused_before - u_" << kernel->name << "_size / 2;\n";
+    }
+
+    shader << "\n";
+    shader << "  // " << kernels.size() << " kernels share every fetch\n";
+    shader << "  for (int i = 0; i < u_fused_size; i++)\n  {\n";
+    shader << "    for (int j = 0; j < u_fused_size; j++)\n    {\n";
+    shader << "      vec3 s = texture(u_texture, i_fwd.uv.xy + vec2(fx * float(i - u_fused_before), fy * float(j - u_fused_before))).rgb;\n\n";
+
+    // Taps are visited in the same i, j order as the separate loops, so every sum is accumulated identically
+    for (const kernel* kernel : kernels)
+    {
+      std::string o{ kernel->name + "_o" };
+      std::string k{ "u_" + kernel->name + "_size" };
+
+      shader << "      if (uint(i - " << o << ") < uint(" << k << ") && uint(j - " << o << ") < uint(" << k << ")) ";
+      shader << kernel->name << "_sum += u_weights[u_" << kernel->name << "_offset + (i - " << o << ") + (j - " << o << ") * " << k << "] * s." << "rgb"[kernel->channel] << ";\n";
     }
 
     shader << "    }\n";
@@ -460,13 +1373,78 @@ namespace we
   void system::stringify_results(const kernel& kernel, std::stringstream& shader)
   {
     shader << "  float " << kernel.name << "_g = " << kernel.name << "_growth(" << kernel.name << "_sum);\n";
-    shader << "  float " << kernel.name << "_avg = " << kernel.name << "_sum / " << kernel.size * kernel.size << ";\n";
+    shader << "  float " << kernel.name << "_avg = " << kernel.name << "_sum / float(u_" << kernel.name << "_size * u_" << kernel.name << "_size);\n";
     shader << "  float " << kernel.name << "_c = u_" << kernel.name << "_time * " << kernel.name << "_avg / " << kernel.name << "_g;\n\n";
   }
 
+  void system::stringify_mixing(std::stringstream& shader)
+  {
+    //shader << "  float rm = c.r + r0_c + r1_c + r2_c + g0_c + g1_c + g2_c + b0_c + b1_c + b2_c;\n";
+    //shader << "  float gm = c.g + r0_c + r1_c + r2_c + g0_c + g1_c + g2_c + b0_c + b1_c + b2_c;\n";
+    //shader << "  float bm = c.b + r0_c + r1_c + r2_c + g0_c + g1_c + g2_c + b0_c + b1_c + b2_c;\n\n";
+
+    //shader << "  float rm = c.r + g0_c + g1_c + g2_c + b0_c + b1_c + b2_c;\n";
+    //shader << "  float gm = c.g + r0_c + r1_c + r2_c + b0_c + b1_c + b2_c;\n";
+    //shader << "  float bm = c.b + r0_c + r1_c + r2_c + g0_c + g1_c + g2_c;\n\n";
+
+    //shader << "  float rm = c.r + g0_c + g1_c + g2_c;\n";
+    //shader << "  float gm = c.g + b0_c + b1_c + b2_c;\n";
+    //shader << "  float bm = c.b + r0_c + r1_c + r2_c;\n\n";
+
+    shader << "  float rm = c.r + r0_c + g1_c + b2_c;\n";
+    shader << "  float gm = c.g + r1_c + g2_c + b0_c;\n";
+    shader << "  float bm = c.b + r2_c + g0_c + b1_c;\n\n";
+
+    shader << "  float r = clamp(rm, 0.0, 1.0);\n";
+    shader << "  float g = clamp(gm, 0.0, 1.0);\n";
+    shader << "  float b = clamp(bm, 0.0, 1.0);\n\n";
+  }
+
+  void system::stringify_rows(const kernel& kernel, std::stringstream& shader)
+  {
+    if (!is_separable(kernel)) return;
+
+    shader << "const float c_" << kernel.name << "_rows[" << kernel.rank << "][" << kernel.size << "] =\n{\n";
+    for (std::uint32_t r{}; r < kernel.rank; r++)
+    {
+      shader << "  { ";
+      for (std::uint32_t i{}; i < kernel.size; i++)
+      {
+        shader << std::format("{:.7f}", kernel.rows[r * kernel.size + i]) << ", ";
+      }
+      shader << "},\n";
+    }
+    shader << "};\n\n";
+  }
+
+  void system::stringify_terms(const kernel& kernel, std::stringstream& shader, std::uint32_t group)
+  {
+    if (!is_separable(kernel)) return;
+
+    std::uint32_t begin{ std::max(kernel.term, group * 4) };
+    std::uint32_t end{ std::min(kernel.term + kernel.rank, group * 4 + 4) };
+
+    if (begin >= end) return;
+
+    shader << "      for (int i = 0; i < " << kernel.size << "; i++)\n      {\n";
+    shader << "        float s = texelFetch(u_texture, ivec2((p.x + i - " << kernel.size / 2 << " + size.x) % size.x, y), 0)." << "rgb"[kernel.channel] << ";\n";
+
+    for (std::uint32_t t{ begin }; t < end; t++)
+    {
+      shader << "        t." << "xyzw"[t % 4] << " += c_" << kernel.name << "_rows[" << t - kernel.term << "][i] * s;\n";
+    }
+
+    shader << "      }\n";
+  }
+
   std::float_t system::bump(std::float_t x, std::float_t height, std::float_t offset, std::float_t smoothness, std::uint32_t sharpness)
   {
-    return (height / (1.0f + std::powf(std::fabsf((x - offset) / smoothness), static_cast<std::float_t>(sharpness)))) - 1.0f;
+    return (height / (1.0f + growth_table::power(std::fabs((x - offset) / smoothness), sharpness))) - 1.0f;
+  }
+
+  std::float_t system::bump_table(std::float_t x, std::float_t height, std::float_t offset, std::float_t smoothness, std::uint32_t sharpness)
+  {
+    return height * growth_table::sample(std::fabs((x - offset) / smoothness), sharpness) - 1.0f;
   }
 
   //void system::compute_color_avg(std::float_t& avg)
@@ -3,10 +3,20 @@
 
 #include <cstdint>
 #include <cmath>
+#include <string>
+#include <sstream>
+#include <random>
 #include <array>
 #include <vector>
 #include <map>
 #include <unordered_map>
+#include <chrono>
+#include <atomic>
+#include <memory>
+
+#include <texture.h>
+#include <shader.h>
+#include <task_queue.h>
 
 #define PATTERN_DIR "C:\\Users\\Michael\\Downloads\\Lenia\\patterns\\"
 
@@ -20,6 +30,25 @@ namespace we
     std::uint32_t sharpness{};
   };
 
+  struct tap
+  {
+    std::int32_t dx{};
+    std::int32_t dy{};
+    std::float_t weight{};
+  };
+
+  // Resolved once per program, -1 when the compiler dropped the uniform
+  struct locations
+  {
+    std::int32_t time{ -1 };
+    std::int32_t growth_height{ -1 };
+    std::int32_t growth_offset{ -1 };
+    std::int32_t growth_smoothness{ -1 };
+    std::int32_t growth_sharpness{ -1 };
+    std::int32_t size{ -1 };
+    std::int32_t offset{ -1 };
+  };
+
   struct kernel
   {
     std::string name{};
@@ -32,6 +61,16 @@ namespace we
     growth growth{};
     std::vector<std::float_t> values{};
     std::uint32_t texture{};
+    std::uint32_t rank{};
+    std::float_t rank_error{};
+    std::vector<std::float_t> rows{};
+    std::vector<std::float_t> cols{};
+    std::uint32_t term{};
+    std::uint32_t weight_offset{};
+    std::vector<tap> taps{};
+    std::float_t density{};
+    locations locations{};
+    std::uint32_t slot{};
   };
 
   class system
@@ -42,20 +81,34 @@ namespace we
       e_tex_front,
       e_tex_back,
       e_tex_gen,
+      e_tex_terms,
     };
     enum framebuffer_idx
     {
       e_fb_front,
       e_fb_back,
       e_fb_gen,
+      e_fb_terms,
     };
     enum vao_idx
     {
       e_vao_rect,
     };
+    enum buffer_idx
+    {
+      e_buf_weights,
+    };
     enum shader_idx
     {
       e_prog_conv,
+      e_prog_terms,
+      e_prog_compute,
+    };
+    enum slot_state
+    {
+      e_slot_idle,
+      e_slot_busy,
+      e_slot_ready,
     };
 
   public:
@@ -65,35 +118,118 @@ namespace we
     inline void set_dirty() { m_dirty = 1; }
     inline std::uint32_t get_dirty() const { return m_dirty; }
 
+    // Bumped whenever a kernel parameter changes, for copies such as grid layers
+    inline std::uint32_t get_revision() const { return m_revision; }
+
+    inline const std::unordered_multimap<std::uint32_t, kernel>& get_kernels() const { return m_kernels; }
+
+    // Current world and generator, for copies such as grid layers
+    inline std::uint32_t get_front() const { return m_textures[e_tex_front]; }
+    inline std::uint32_t get_generator() const { return m_textures[e_tex_gen]; }
+
+    inline bool is_compiling() const { return m_build.pending; }
+    inline bool get_growth_table() const { return m_growth_table; }
+
   public:
     void update();
     void swap();
     void draw(std::float_t x, std::float_t y, std::float_t scale_x, std::float_t scale_y);
     void ui();
     void randomize();
+    void verify();
+
+  public:
+    static void create_kernels(std::unordered_multimap<std::uint32_t, kernel>& kernels);
+    static void compute_kernel(kernel& kernel);
+    static std::float_t bump(std::float_t x, std::float_t height, std::float_t offset, std::float_t smoothness, std::uint32_t sharpness);
+    static std::float_t bump_table(std::float_t x, std::float_t height, std::float_t offset, std::float_t smoothness, std::uint32_t sharpness);
+
+    // Rows of growth_table in a storage buffer, shared by every program that samples it
+    static std::uint32_t get_growth_buffer();
 
   private:
     void rebuild_kernel();
+    void rebuild_edited();
+    void rebuild_weights();
+    void bind_weights();
+    void rebuild_factors();
+    void rebuild_taps();
     void rebuild_shader();
+    void finish_shader(bool wait);
+    void rebuild_locations();
+    void rebuild_terms();
+    void rebuild_compute();
     void rebuild_preview();
+    void rebuild_storage(texture::format storage);
 
   private:
-    void update_uniforms(kernel& kernel);
+    void locate_uniforms(kernel& kernel);
+    void update_uniforms(const kernel& kernel);
 
   private:
+    void mark_edit();
     void ui_kernel(kernel& kernel);
-    void compute_kernel(kernel& kernel);
     void randomize_kernel(kernel& kernel, std::mt19937& generator);
 
+  private:
+    static void copy_shape(const kernel& source, kernel& target);
+    static task_queue& get_tasks();
+
+  private:
+    void assign_terms(kernel& kernel, std::uint32_t& term);
+    bool is_separable(const kernel& kernel) const;
+    bool is_sparse(const kernel& kernel) const;
+    bool is_fused(const kernel& kernel) const;
+    bool is_compute() const;
+    bool is_tile_stale() const;
+
   private:
     void stringify_uniforms(const kernel& kernel, std::stringstream& shader, std::uint32_t& location);
     void stringify_kernel(const kernel& kernel, std::stringstream& shader);
+    void stringify_growth_shape(std::stringstream& shader);
     void stringify_growth(const kernel& kernel, std::stringstream& shader);
     void stringify_convolution(const kernel& kernel, std::stringstream& shader);
+    void stringify_fused_convolution(std::stringstream& shader);
     void stringify_results(const kernel& kernel, std::stringstream& shader);
+    void stringify_mixing(std::stringstream& shader);
+    void stringify_rows(const kernel& kernel, std::stringstream& shader);
+    void stringify_terms(const kernel& kernel, std::stringstream& shader, std::uint32_t group);
+
+  private:
+    // Second buffer of a kernel. The ui edits the shape in `edit`, a background task generates
+    // `work` from a copy of it, and rebuild_edited swaps the result into the kernel between steps
+    struct slot
+    {
+      kernel edit{};
+      kernel work{};
+      bool dirty{};
+      bool factored{};
+      std::atomic<std::uint32_t> state{};
+    };
 
   private:
-    std::float_t bump(std::float_t x, std::float_t height, std::float_t offset, std::float_t smoothness, std::uint32_t sharpness);
+    // Programs of the next rebuild_shader, linking while the current ones keep stepping
+    struct build
+    {
+      std::array<shader::job, 3> jobs{};
+      std::uint32_t term_groups{};
+      std::uint32_t compute_group{};
+      std::uint32_t compute_before{};
+      std::uint32_t compute_size{};
+      bool pending{};
+    };
+
+  private:
+    // What swap feeds the current programs, only replaced together with them. Sizes and
+    // offsets are indexed by kernel slot
+    struct bound
+    {
+      std::vector<std::uint32_t> sizes{};
+      std::vector<std::uint32_t> offsets{};
+      std::uint32_t fused_before{};
+      std::uint32_t fused_size{};
+      bool growth_table{};
+    };
 
   private:
     std::uint32_t m_system_width{};
@@ -103,14 +239,52 @@ namespace we
     std::uint32_t m_generator_height{};
 
     std::unordered_multimap<std::uint32_t, kernel> m_kernels{};
+    std::vector<std::unique_ptr<slot>> m_slots{};
 
-    std::array<std::uint32_t, 3> m_textures{};
-    std::array<std::uint32_t, 3> m_fbos{};
+    std::array<std::uint32_t, 4> m_textures{};
+    std::array<std::uint32_t, 4> m_fbos{};
     std::array<std::uint32_t, 1> m_vaos{};
-    std::array<std::uint32_t, 1> m_programs{};
+    std::array<std::uint32_t, 1> m_buffers{};
+    std::array<std::uint32_t, 3> m_programs{};
+
+    std::int32_t m_texture_size_location{ -1 };
+    std::int32_t m_fused_before_location{ -1 };
+    std::int32_t m_fused_size_location{ -1 };
+
+    bool m_lowrank{};
+    std::float_t m_lowrank_error{ 0.01f };
+    std::uint32_t m_term_groups{};
+
+    bool m_sparse{};
+    std::float_t m_sparse_cutoff{};
+
+    bool m_fused{ true };
+    std::uint32_t m_fused_before{};
+    std::uint32_t m_fused_size{};
+
+    // Work group edge of the compute program, 0 while stepping through the fragment pass
+    bool m_compute{};
+    std::uint32_t m_compute_group{};
+    std::uint32_t m_compute_before{};
+    std::uint32_t m_compute_size{};
+
+    // Growth interpolated from growth_table instead of computing the power
+    bool m_growth_table{};
+
+    build m_build{};
+    bound m_bound{};
+
+    texture::format m_storage{ texture::e_format_unorm8 };
 
     std::uint32_t m_iteration{};
     std::uint32_t m_dirty{};
+    std::uint32_t m_revision{};
+
+    // From the first edit not yet applied until update has applied all of them
+    std::chrono::steady_clock::time_point m_edit_time{};
+    std::double_t m_edit_latency{};
+    bool m_edit_pending{};
+    bool m_generating{};
   };
 }
 
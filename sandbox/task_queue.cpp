@@ -0,0 +1,68 @@
+#include <algorithm>
+
+#include <task_queue.h>
+
+namespace we
+{
+  task_queue::task_queue(std::uint32_t thread_count)
+  {
+    if (thread_count == 0)
+    {
+      thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    for (std::uint32_t i{}; i < thread_count; i++)
+    {
+      m_threads.emplace_back(&task_queue::worker, this);
+    }
+  }
+
+  task_queue::~task_queue()
+  {
+    {
+      std::lock_guard<std::mutex> lock{ m_mutex };
+
+      m_exit = 1;
+    }
+
+    m_wake.notify_all();
+
+    for (std::thread& thread : m_threads)
+    {
+      thread.join();
+    }
+  }
+
+  void task_queue::post(std::function<void()> task)
+  {
+    {
+      std::lock_guard<std::mutex> lock{ m_mutex };
+
+      m_tasks.emplace_back(std::move(task));
+    }
+
+    m_wake.notify_one();
+  }
+
+  void task_queue::worker()
+  {
+    while (true)
+    {
+      std::function<void()> task{};
+
+      {
+        std::unique_lock<std::mutex> lock{ m_mutex };
+
+        m_wake.wait(lock, [this] { return m_exit || !m_tasks.empty(); });
+
+        // Tasks still queued on exit are dropped
+        if (m_exit) return;
+
+        task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+      }
+
+      task();
+    }
+  }
+}
\ No newline at end of file
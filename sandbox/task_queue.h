@@ -0,0 +1,40 @@
+#ifndef WE_TASK_QUEUE_H
+#define WE_TASK_QUEUE_H
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace we
+{
+  // Background threads for work that must not hold up a frame. Unlike thread_pool nothing
+  // waits for a posted task, so it reports back through state it owns, and the callers
+  // pick the result up whenever they next look.
+  class task_queue
+  {
+  public:
+    task_queue(std::uint32_t thread_count);
+    ~task_queue();
+
+  public:
+    void post(std::function<void()> task);
+
+  private:
+    void worker();
+
+  private:
+    std::vector<std::thread> m_threads{};
+    std::deque<std::function<void()>> m_tasks{};
+
+    std::mutex m_mutex{};
+    std::condition_variable m_wake{};
+
+    std::uint32_t m_exit{};
+  };
+}
+
+#endif
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include <vector>
 #include <random>
 #include <fstream>
+#include <array>
 
 #include <texture.h>
 
@@ -8,7 +9,7 @@
 
 namespace we
 {
-  void texture::create_fill(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, std::float_t value)
+  void texture::create_fill(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, std::float_t value, format format)
   {
     std::vector<std::float_t> values{};
     std::uint32_t size{ width * height * 4 };
@@ -31,10 +32,10 @@ namespace we
     glGenTextures(1, &texture);
 
     glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_FLOAT, 0);
+    glTexImage2D(GL_TEXTURE_2D, 0, get_internal_format(format), width, height, 0, GL_RGBA, GL_FLOAT, 0);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_FLOAT, &values[0]);
+    glTexImage2D(GL_TEXTURE_2D, 0, get_internal_format(format), width, height, 0, GL_RGBA, GL_FLOAT, &values[0]);
     glBindTexture(GL_TEXTURE_2D, 0);
   }
 
@@ -72,7 +73,7 @@ namespace we
     glBindTexture(GL_TEXTURE_2D, 0);
   }
 
-  void texture::create_random_rgb(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, std::float_t min, std::float_t max)
+  void texture::create_random_rgb(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, std::float_t min, std::float_t max, format format)
   {
     std::random_device random{};
     std::mt19937 generator{ random() };
@@ -98,10 +99,10 @@ namespace we
     glGenTextures(1, &texture);
 
     glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_FLOAT, 0);
+    glTexImage2D(GL_TEXTURE_2D, 0, get_internal_format(format), width, height, 0, GL_RGBA, GL_FLOAT, 0);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_FLOAT, &values[0]);
+    glTexImage2D(GL_TEXTURE_2D, 0, get_internal_format(format), width, height, 0, GL_RGBA, GL_FLOAT, &values[0]);
     glBindTexture(GL_TEXTURE_2D, 0);
   }
 
@@ -151,20 +152,128 @@ namespace we
     glBindTexture(GL_TEXTURE_2D, 0);
   }
 
-  void texture::create_from_values(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, const std::vector<std::float_t>& values)
+  void texture::create_from_values(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, const std::vector<std::float_t>& values, format format)
   {
     glGenTextures(1, &texture);
 
     glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_FLOAT, 0);
+    glTexImage2D(GL_TEXTURE_2D, 0, get_internal_format(format), width, height, 0, GL_RGBA, GL_FLOAT, 0);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_FLOAT, &values[0]);
+    glTexImage2D(GL_TEXTURE_2D, 0, get_internal_format(format), width, height, 0, GL_RGBA, GL_FLOAT, &values[0]);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+
+  void texture::create_from_plane(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, const std::vector<std::float_t>& plane)
+  {
+    // One float per texel, shown as grey
+    std::array<std::int32_t, 4> swizzle{ GL_RED, GL_RED, GL_RED, GL_ONE };
+
+    glGenTextures(1, &texture);
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, &plane[0]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, &swizzle[0]);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+
+  void texture::update_from_plane(std::uint32_t texture, std::uint32_t width, std::uint32_t height, const std::vector<std::float_t>& plane)
+  {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RED, GL_FLOAT, &plane[0]);
     glBindTexture(GL_TEXTURE_2D, 0);
   }
 
+  void texture::create_from_planes(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, const std::vector<std::float_t>& planes, format format)
+  {
+    std::uint32_t cells{ width * height };
+
+    // A GL_RED, GL_GREEN or GL_BLUE upload replaces the whole texel, zero in the other
+    // channels and one in alpha, so the planes have to be interleaved here
+    std::vector<std::float_t> values{};
+
+    values.resize(cells * 4);
+
+    for (std::uint32_t i{}; i < cells; i++)
+    {
+      values[i * 4 + 0] = planes[i];
+      values[i * 4 + 1] = planes[cells + i];
+      values[i * 4 + 2] = planes[cells * 2 + i];
+      values[i * 4 + 3] = 1.0f;
+    }
+
+    create_from_values(texture, width, height, values, format);
+  }
+
+  void texture::create_float(std::uint32_t& texture, std::uint32_t width, std::uint32_t height)
+  {
+    glGenTextures(1, &texture);
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+
+  void texture::create_fill_array(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, std::uint32_t layers, std::float_t value, format format)
+  {
+    std::array<std::float_t, 4> fill{ value, value, value, 1.0f };
+
+    glGenTextures(1, &texture);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, get_internal_format(format), width, height, layers, 0, GL_RGBA, GL_FLOAT, 0);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glClearTexImage(texture, 0, GL_RGBA, GL_FLOAT, &fill[0]);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  }
+
+  void texture::create_random_rgb_array(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, std::uint32_t layers, std::float_t min, std::float_t max, format format)
+  {
+    std::random_device random{};
+    std::mt19937 generator{ random() };
+    std::uniform_real_distribution<std::float_t> dist{ min, max };
+    std::vector<std::float_t> values{};
+    std::uint32_t size{ width * height * layers * 4 };
+
+    values.resize(size);
+
+    for (std::uint32_t i{}; i < size; i += 4)
+    {
+      values[i + 0] = dist(generator);
+      values[i + 1] = dist(generator);
+      values[i + 2] = dist(generator);
+      values[i + 3] = 1.0f;
+    }
+
+    glGenTextures(1, &texture);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, get_internal_format(format), width, height, layers, 0, GL_RGBA, GL_FLOAT, &values[0]);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  }
+
   void texture::destroy(std::uint32_t texture)
   {
     glDeleteTextures(1, &texture);
   }
+
+  std::int32_t texture::get_internal_format(format format)
+  {
+    // RGB16F is not required to be colour renderable, so half keeps the unused alpha
+    switch (format)
+    {
+      case e_format_unorm8: return GL_RGBA8;
+      case e_format_half: return GL_RGBA16F;
+      case e_format_float: return GL_RGBA32F;
+    }
+
+    return GL_RGBA8;
+  }
 }
\ No newline at end of file
@@ -9,17 +9,37 @@ namespace we
 {
   class texture
   {
+  public:
+    // Colour storage of the render targets, 4, 8 and 16 bytes per texel
+    enum format
+    {
+      e_format_unorm8,
+      e_format_half,
+      e_format_float,
+    };
+
   public:
     texture() = delete;
 
   public:
-    static void create_fill(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, std::float_t value);
+    static void create_fill(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, std::float_t value, format format = e_format_unorm8);
     static void create_random_r(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, std::float_t min, std::float_t max);
-    static void create_random_rgb(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, std::float_t min, std::float_t max);
+    static void create_random_rgb(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, std::float_t min, std::float_t max, format format = e_format_unorm8);
     static void create_from_file(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, const std::string& file);
-    static void create_from_values(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, const std::vector<std::float_t>& values);
+    static void create_from_values(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, const std::vector<std::float_t>& values, format format = e_format_unorm8);
+    static void create_from_plane(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, const std::vector<std::float_t>& plane);
+    static void update_from_plane(std::uint32_t texture, std::uint32_t width, std::uint32_t height, const std::vector<std::float_t>& plane);
+    static void create_from_planes(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, const std::vector<std::float_t>& planes, format format = e_format_unorm8);
+    static void create_float(std::uint32_t& texture, std::uint32_t width, std::uint32_t height);
+
+    static void create_fill_array(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, std::uint32_t layers, std::float_t value, format format = e_format_unorm8);
+    static void create_random_rgb_array(std::uint32_t& texture, std::uint32_t width, std::uint32_t height, std::uint32_t layers, std::float_t min, std::float_t max, format format = e_format_unorm8);
 
     static void destroy(std::uint32_t texture);
+
+  public:
+    // Sized, so the same format also binds the texture as an image
+    static std::int32_t get_internal_format(format format);
   };
 }
 
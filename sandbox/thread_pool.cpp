@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <chrono>
+
+#include <thread_pool.h>
+
+namespace we
+{
+  thread_pool::thread_pool(std::uint32_t thread_count)
+  {
+    if (thread_count == 0)
+    {
+      thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    for (std::uint32_t i{}; i < thread_count; i++)
+    {
+      m_workers.emplace_back(std::make_unique<worker_state>());
+    }
+
+    // The calling thread takes part in every dispatch as worker 0
+    for (std::uint32_t i{ 1 }; i < thread_count; i++)
+    {
+      m_threads.emplace_back(&thread_pool::worker, this, i);
+    }
+  }
+
+  thread_pool::~thread_pool()
+  {
+    {
+      std::lock_guard<std::mutex> lock{ m_mutex };
+
+      m_exit = 1;
+    }
+
+    m_wake.notify_all();
+
+    for (std::thread& thread : m_threads)
+    {
+      thread.join();
+    }
+  }
+
+  void thread_pool::run(std::uint32_t count, std::uint32_t grain, const void* task, invoke invoke)
+  {
+    auto start{ std::chrono::steady_clock::now() };
+
+    {
+      std::lock_guard<std::mutex> lock{ m_mutex };
+
+      m_task = task;
+      m_invoke = invoke;
+      m_count = count;
+      m_grain = std::max(grain, 1u);
+
+      std::uint32_t chunks{ (m_count + m_grain - 1) / m_grain };
+      std::uint32_t workers{ static_cast<std::uint32_t>(m_workers.size()) };
+
+      // Contiguous blocks keep neighbouring rows on one core until someone runs dry
+      for (std::uint32_t w{}; w < workers; w++)
+      {
+        deque& queue{ m_workers[w]->queue };
+
+        std::uint32_t begin{ static_cast<std::uint32_t>(static_cast<std::uint64_t>(chunks) * w / workers) };
+        std::uint32_t end{ static_cast<std::uint32_t>(static_cast<std::uint64_t>(chunks) * (w + 1) / workers) };
+
+        // Stored descending so the owner pops them in ascending order from the bottom
+        queue.chunks.resize(end - begin);
+
+        for (std::uint32_t i{}; i < end - begin; i++)
+        {
+          queue.chunks[i] = end - 1 - i;
+        }
+
+        queue.top = 0;
+        queue.bottom = end - begin;
+      }
+
+      m_pending = chunks;
+      m_busy = static_cast<std::uint32_t>(m_threads.size());
+      m_generation++;
+    }
+
+    m_wake.notify_all();
+
+    execute(0);
+
+    std::unique_lock<std::mutex> lock{ m_mutex };
+
+    m_done.wait(lock, [this] { return m_busy == 0; });
+
+    m_task = nullptr;
+    m_invoke = nullptr;
+
+    m_seconds += std::chrono::duration<std::double_t>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  void thread_pool::reset_stats()
+  {
+    for (std::unique_ptr<worker_state>& worker : m_workers)
+    {
+      worker->counters = stats{};
+    }
+
+    m_seconds = 0.0;
+  }
+
+  void thread_pool::worker(std::uint32_t index)
+  {
+    std::uint32_t generation{};
+
+    s_pool = this;
+    s_worker = index;
+
+    while (1)
+    {
+      {
+        std::unique_lock<std::mutex> lock{ m_mutex };
+
+        m_wake.wait(lock, [&] { return m_exit || m_generation != generation; });
+
+        if (m_exit) break;
+
+        generation = m_generation;
+      }
+
+      execute(index);
+
+      {
+        std::lock_guard<std::mutex> lock{ m_mutex };
+
+        if (--m_busy == 0) m_done.notify_one();
+      }
+    }
+  }
+
+  void thread_pool::execute(std::uint32_t index)
+  {
+    worker_state& self{ *m_workers[index] };
+
+    std::uint32_t workers{ static_cast<std::uint32_t>(m_workers.size()) };
+
+    while (m_pending.load() > 0)
+    {
+      std::uint32_t chunk{};
+
+      if (pop(self.queue, chunk))
+      {
+        self.counters.chunks++;
+      }
+      else
+      {
+        bool stolen{};
+        bool empty{ true };
+
+        for (std::uint32_t i{ 1 }; i < workers && !stolen; i++)
+        {
+          deque& queue{ m_workers[(index + i) % workers]->queue };
+
+          if (queue.top.load() >= queue.bottom.load()) continue;
+
+          empty = false;
+          stolen = steal(queue, chunk);
+        }
+
+        // Nothing is pushed during a dispatch, so once every deque is empty whatever is left
+        // is already running elsewhere and this worker parks instead of spinning on the tail
+        if (empty) break;
+        if (!stolen) continue;
+
+        self.counters.chunks++;
+        self.counters.steals++;
+      }
+
+      std::uint32_t begin{ chunk * m_grain };
+      std::uint32_t end{ std::min(begin + m_grain, m_count) };
+
+      auto start{ std::chrono::steady_clock::now() };
+
+      m_invoke(m_task, begin, end);
+
+      self.counters.busy_seconds += std::chrono::duration<std::double_t>(std::chrono::steady_clock::now() - start).count();
+
+      m_pending.fetch_sub(1);
+    }
+  }
+
+  bool thread_pool::pop(deque& queue, std::uint32_t& chunk)
+  {
+    std::int64_t b{ queue.bottom.load() - 1 };
+
+    queue.bottom.store(b);
+
+    std::int64_t t{ queue.top.load() };
+
+    if (t > b)
+    {
+      queue.bottom.store(b + 1);
+
+      return false;
+    }
+
+    chunk = queue.chunks[b];
+
+    if (t < b) return true;
+
+    // Last chunk, thieves may be racing for it
+    bool won{ queue.top.compare_exchange_strong(t, t + 1) };
+
+    queue.bottom.store(b + 1);
+
+    return won;
+  }
+
+  bool thread_pool::steal(deque& queue, std::uint32_t& chunk)
+  {
+    std::int64_t t{ queue.top.load() };
+    std::int64_t b{ queue.bottom.load() };
+
+    if (t >= b) return false;
+
+    chunk = queue.chunks[t];
+
+    return queue.top.compare_exchange_strong(t, t + 1);
+  }
+}
\ No newline at end of file
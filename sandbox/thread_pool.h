@@ -0,0 +1,109 @@
+#ifndef WE_THREAD_POOL_H
+#define WE_THREAD_POOL_H
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace we
+{
+  // Splits each dispatch into chunks of `grain` and hands every worker a contiguous block
+  // of them in its own deque. Owners pop from the bottom in ascending order, idle workers
+  // steal from the top of other deques, so uneven chunks even out without a shared lock.
+  // A worker that finds every deque empty goes back to waiting for the next dispatch.
+  // Worker 0 is the calling thread.
+  //
+  // Tasks are taken by reference and called through a plain function pointer rather than
+  // a std::function, so a dispatch never allocates. get_worker lets a task pick scratch
+  // space that belongs to the worker running it.
+  class thread_pool
+  {
+  public:
+    struct stats
+    {
+      std::uint64_t chunks{};
+      std::uint64_t steals{};
+      std::double_t busy_seconds{};
+    };
+
+  public:
+    thread_pool(std::uint32_t thread_count);
+    ~thread_pool();
+
+  public:
+    inline std::uint32_t get_thread_count() const { return static_cast<std::uint32_t>(m_threads.size()) + 1; }
+    inline const stats& get_stats(std::uint32_t worker) const { return m_workers[worker]->counters; }
+    inline std::double_t get_utilization(std::uint32_t worker) const { return m_seconds > 0.0 ? m_workers[worker]->counters.busy_seconds / m_seconds : 0.0; }
+
+    // Index of the worker on the calling thread within this pool, 0 for the thread that dispatches,
+    // also when that thread is itself a worker of another pool
+    inline std::uint32_t get_worker() const { return (s_pool == this) ? s_worker : 0; }
+
+  public:
+    template<typename function>
+    inline void dispatch(std::uint32_t count, std::uint32_t grain, const function& task)
+    {
+      run(count, grain, &task, [](const void* task, std::uint32_t begin, std::uint32_t end) { (*static_cast<const function*>(task))(begin, end); });
+    }
+
+    void reset_stats();
+
+  private:
+    using invoke = void(*)(const void* task, std::uint32_t begin, std::uint32_t end);
+
+  private:
+    // Chase-Lev deque of chunk indices, filled by dispatch while every worker is parked
+    struct deque
+    {
+      std::vector<std::uint32_t> chunks{};
+      std::atomic<std::int64_t> top{};
+      std::atomic<std::int64_t> bottom{};
+    };
+
+    struct worker_state
+    {
+      deque queue{};
+      stats counters{};
+    };
+
+  private:
+    void run(std::uint32_t count, std::uint32_t grain, const void* task, invoke invoke);
+    void worker(std::uint32_t index);
+    void execute(std::uint32_t index);
+
+  private:
+    static bool pop(deque& queue, std::uint32_t& chunk);
+    static bool steal(deque& queue, std::uint32_t& chunk);
+
+  private:
+    inline static thread_local const thread_pool* s_pool{};
+    inline static thread_local std::uint32_t s_worker{};
+
+  private:
+    std::vector<std::thread> m_threads{};
+    std::vector<std::unique_ptr<worker_state>> m_workers{};
+
+    std::mutex m_mutex{};
+    std::condition_variable m_wake{};
+    std::condition_variable m_done{};
+
+    const void* m_task{};
+    invoke m_invoke{};
+    std::uint32_t m_count{};
+    std::uint32_t m_grain{};
+    std::atomic<std::uint32_t> m_pending{};
+
+    std::uint32_t m_generation{};
+    std::uint32_t m_busy{};
+    std::uint32_t m_exit{};
+
+    std::double_t m_seconds{};
+  };
+}
+
+#endif
\ No newline at end of file